@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace arena {
+
+// Hands out contiguous arrays of T carved from large blocks, all of which
+// are freed together with the arena. Arrays never move, so pointers into
+// them stay valid while the arena grows and when it is moved.
+template <typename T>
+class Arena {
+public:
+    static constexpr size_t BLOCK_BYTES = 64 * 1024;
+
+    Arena() = default;
+
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Arrays longer than a block get a block of their own
+    T* Allocate(size_t count)
+    {
+        if (count > BLOCK_SIZE)
+        {
+            blocks_.push_back(std::make_unique<T[]>(count));
+            return blocks_.back().get();
+        }
+
+        if (blocks_.empty() || block_used_ + count > BLOCK_SIZE)
+        {
+            blocks_.push_back(std::make_unique<T[]>(BLOCK_SIZE));
+            current_block_ = blocks_.back().get();
+            block_used_ = 0;
+        }
+
+        T* result = current_block_ + block_used_;
+        block_used_ += count;
+
+        return result;
+    }
+
+    template <typename It>
+    T* Copy(It first, It last)
+    {
+        T* result = Allocate(static_cast<size_t>(std::distance(first, last)));
+        std::copy(first, last, result);
+
+        return result;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = std::max<size_t>(
+        BLOCK_BYTES / sizeof(T), 1);
+
+    std::vector<std::unique_ptr<T[]>> blocks_;
+    T* current_block_ = nullptr;
+    size_t block_used_ = 0;
+};
+
+// Copies the string into the pool and returns a view of the copy
+inline std::string_view StoreString(Arena<char>& pool, std::string_view str)
+{
+    return {pool.Copy(str.begin(), str.end()), str.size()};
+}
+
+}  // namespace arena
@@ -0,0 +1,478 @@
+#include "bounded_search.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "min_plus.h"
+#include "serialization.h"
+#include "synthetic_city.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+struct BenchSettings {
+    synthetic_city::CitySettings city;
+    size_t repetitions = 3;
+    // Also builds the router with the reference kernel, failing unless
+    // both find the same routes
+    size_t check_router = 0;
+    std::string base_file = "transport_catalogue_bench.db";
+    // Prints the generated input of this mode instead of benchmarking
+    std::string print_mode;
+};
+
+// Wall times of every run of a phase, items are what the phase handles
+// per run, e.g. requests of a batch
+struct Measurement {
+    std::string name;
+    size_t items = 1;
+    std::vector<double> seconds;
+};
+
+class Measurements {
+public:
+    template <typename Function>
+    void Measure(const std::string& name, size_t items, Function&& function) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        auto it = std::find_if(measurements_.begin(), measurements_.end(),
+            [&name](const Measurement& measurement) {
+                return measurement.name == name;
+            });
+        if (it == measurements_.end()) {
+            it = measurements_.insert(measurements_.end(), {name, items, {}});
+        }
+        it->seconds.push_back(elapsed.count());
+    }
+
+    json::Array ToJson() const {
+        json::Array results;
+        for (const Measurement& measurement : measurements_) {
+            std::vector<double> seconds = measurement.seconds;
+            std::sort(seconds.begin(), seconds.end());
+            const double median = seconds[seconds.size() / 2];
+            const double mean = std::accumulate(seconds.begin(),
+                seconds.end(), 0.0) / seconds.size();
+
+            results.push_back(json::Builder{}.StartDict()
+                .Key("name"s).Value(measurement.name)
+                .Key("items"s).Value(static_cast<int>(measurement.items))
+                .Key("min_ms"s).Value(seconds.front() * 1e3)
+                .Key("median_ms"s).Value(median * 1e3)
+                .Key("mean_ms"s).Value(mean * 1e3)
+                .Key("median_ns_per_item"s)
+                .Value(median * 1e9 / measurement.items)
+                .EndDict().Build());
+        }
+        return results;
+    }
+
+private:
+    std::vector<Measurement> measurements_;
+};
+
+bool IsSameRoutes(const transport_router::Router& lhs,
+    const transport_router::Router& rhs) {
+    using Route = std::optional<transport_router::Router::RouteInternalData>;
+    const auto is_same_route = [](const Route& lhs, const Route& rhs) {
+        return lhs.has_value() == rhs.has_value() && (!lhs
+            || (lhs->weight == rhs->weight
+                && lhs->prev_edge == rhs->prev_edge));
+    };
+
+    const auto& lhs_routes = lhs.GetRIDs();
+    const auto& rhs_routes = rhs.GetRIDs();
+    if (lhs_routes.size() != rhs_routes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs_routes.size(); ++i) {
+        if (!std::equal(lhs_routes[i].begin(), lhs_routes[i].end(),
+            rhs_routes[i].begin(), rhs_routes[i].end(), is_same_route)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Vertices of the stops of Route requests
+std::vector<std::pair<graph::VertexId, graph::VertexId>> GetRouteEnds(
+    const transport_catalogue::TransportCatalogue& catalogue,
+    const json::Array& requests) {
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> ends;
+    ends.reserve(requests.size());
+    for (const json::Node& request : requests) {
+        const json::Dict& dict = request.AsDict();
+        ends.emplace_back(catalogue.GetStop(dict.at("from"s).AsString())->edge_id,
+            catalogue.GetStop(dict.at("to"s).AsString())->edge_id);
+    }
+    return ends;
+}
+
+// Runs a per-query search for every Route request, once with the workspace
+// of the thread and once with a new workspace per query, and checks the
+// weights found against the router
+void MeasureRouteSearch(const transport_router::Graph& graph,
+    const transport_router::Router& router,
+    const std::vector<std::pair<graph::VertexId, graph::VertexId>>& ends,
+    Measurements& measurements) {
+    using Workspace = graph::SearchWorkspace<transport_router::Weight>;
+
+    std::vector<std::optional<transport_router::Weight>> weights(ends.size());
+    std::vector<graph::EdgeId> edges;
+    measurements.Measure("search_Route"s, ends.size(), [&] {
+        for (size_t i = 0; i < ends.size(); ++i) {
+            weights[i] = graph::FindRoute(graph, ends[i].first,
+                ends[i].second, edges);
+        }
+    });
+    measurements.Measure("search_Route_fresh_workspace"s, ends.size(), [&] {
+        for (size_t i = 0; i < ends.size(); ++i) {
+            Workspace workspace;
+            weights[i] = graph::FindRoute(graph, ends[i].first,
+                ends[i].second, edges, workspace);
+        }
+    });
+
+    for (size_t i = 0; i < ends.size(); ++i) {
+        const auto expected = router.GetRouteWeight(ends[i].first,
+            ends[i].second);
+        const auto to_minutes = [](transport_router::Weight weight) {
+            return transport_router::WeightTraits::ToMinutes(weight);
+        };
+        // Sums go in another order than in the router
+        if (expected.has_value() != weights[i].has_value() || (expected
+            && std::abs(to_minutes(*expected) - to_minutes(*weights[i]))
+                > 1e-9 * std::max(1.0, to_minutes(*expected)))) {
+            throw std::runtime_error("Search and router found different routes");
+        }
+    }
+}
+
+// Legs a route on the graph of FillGraph is printed with
+domain::Journey MakeJourney(
+    const transport_catalogue::TransportCatalogue& catalogue,
+    const transport_router::Graph& graph, double bus_wait_time,
+    transport_router::Weight weight, const std::vector<graph::EdgeId>& edges) {
+    using transport_router::WeightTraits;
+
+    domain::Journey journey{WeightTraits::ToMinutes(weight), {}};
+    for (const graph::EdgeId edge_id : edges) {
+        const auto& edge = graph.GetEdge(edge_id);
+        journey.legs.push_back({&catalogue.GetAllStops().at(edge.from),
+            bus_wait_time, catalogue.GetBus(edge.bus_name), edge.span_count,
+            WeightTraits::ToMinutes(edge.weight) - bus_wait_time});
+    }
+    return journey;
+}
+
+bool IsSameItinerary(const domain::Journey& lhs, const domain::Journey& rhs) {
+    const auto is_same_leg = [](const domain::JourneyLeg& lhs,
+        const domain::JourneyLeg& rhs) {
+        return lhs.stop_from == rhs.stop_from && lhs.bus == rhs.bus
+            && lhs.span_count == rhs.span_count;
+    };
+    return std::equal(lhs.legs.begin(), lhs.legs.end(), rhs.legs.begin(),
+        rhs.legs.end(), is_same_leg);
+}
+
+json::Dict DescribeGraph(const transport_router::Graph& graph) {
+    return json::Builder{}.StartDict()
+        .Key("vertices"s).Value(static_cast<int>(graph.GetVertexCount()))
+        .Key("edges"s).Value(static_cast<int>(graph.GetEdgeCount()))
+        .EndDict().Build().AsDict();
+}
+
+// Runs the Route requests on the transfer graph and checks that the
+// routes are as fast as the ones found on the graph of FillGraph
+json::Dict MeasureTransferSearch(
+    const transport_catalogue::TransportCatalogue& catalogue,
+    const transport_router::TransportRouter& transport_router,
+    const BenchSettings& settings, const transport_router::Graph& graph,
+    const transport_router::Graph& transfer_graph,
+    const std::vector<std::pair<graph::VertexId, graph::VertexId>>& ends,
+    Measurements& measurements) {
+    using transport_router::Weight;
+
+    std::vector<std::optional<Weight>> weights(ends.size());
+    std::vector<std::vector<graph::EdgeId>> edges(ends.size());
+    measurements.Measure("search_Route_transfer"s, ends.size(), [&] {
+        for (size_t i = 0; i < ends.size(); ++i) {
+            weights[i] = graph::FindRoute(transfer_graph, ends[i].first,
+                ends[i].second, edges[i]);
+        }
+    });
+
+    // A transfer leg may weigh one fixed-point unit more or less than its
+    // FillGraph edge, and doubles are summed in another order, so routes
+    // are compared by weight within that slack and may differ in ties
+    const double bus_wait_time = settings.city.router_settings.bus_wait_time;
+    const double slack = std::is_integral_v<Weight> ? 1.0 : 1e-9;
+    std::vector<graph::EdgeId> expected_edges;
+    int different_itineraries = 0;
+    for (size_t i = 0; i < ends.size(); ++i) {
+        const auto expected = graph::FindRoute(graph, ends[i].first,
+            ends[i].second, expected_edges);
+        if (expected.has_value() != weights[i].has_value()) {
+            throw std::runtime_error("Transfer graph found different routes");
+        }
+        if (!expected) {
+            continue;
+        }
+
+        const domain::Journey journey = transport_router.MakeTransferJourney(
+            catalogue, transfer_graph, *weights[i], edges[i]);
+        const domain::Journey expected_journey = MakeJourney(catalogue, graph,
+            bus_wait_time, *expected, expected_edges);
+        const size_t legs = std::max(journey.legs.size(),
+            expected_journey.legs.size());
+        if (std::abs(static_cast<double>(*weights[i])
+            - static_cast<double>(*expected))
+            > slack * static_cast<double>(legs)) {
+            throw std::runtime_error("Transfer graph found slower routes");
+        }
+        different_itineraries += !IsSameItinerary(journey, expected_journey);
+    }
+
+    return json::Builder{}.StartDict()
+        .Key("classic"s).Value(DescribeGraph(graph))
+        .Key("transfer"s).Value(DescribeGraph(transfer_graph))
+        .Key("route_queries"s).Value(static_cast<int>(ends.size()))
+        .Key("different_itineraries"s).Value(different_itineraries)
+        .EndDict().Build().AsDict();
+}
+
+std::string PrintToString(const json::Node& node) {
+    std::ostringstream output;
+    json::Print(json::Document{node}, output);
+    return output.str();
+}
+
+// Goes through the stages of make_base and process_requests once
+void RunPipeline(const BenchSettings& settings, const std::string& make_base,
+    const std::string& process_requests,
+    const std::map<std::string, json::Array>& stat_requests,
+    Measurements& measurements, json::Dict& graph_models) {
+    {
+        std::istringstream input(make_base);
+        measurements.Measure("json_load"s, 1, [&input] {
+            json::Load(input);
+        });
+    }
+
+    transport_catalogue::TransportCatalogue catalogue;
+    serialization::SerializationMachine sm(catalogue);
+    std::istringstream make_base_input(make_base);
+    json_reader::JsonReader reader(catalogue, sm, make_base_input);
+    sm.SetSettings(reader.GetSerializationSettings());
+
+    measurements.Measure("update_catalogue"s,
+        settings.city.stop_count + settings.city.bus_count, [&reader] {
+            reader.UpdateCatalogue();
+        });
+
+    transport_router::Graph graph(catalogue.GetAllStops().size());
+    const transport_router::TransportRouter transport_router(
+        settings.city.router_settings);
+    measurements.Measure("fill_graph"s, 1, [&] {
+        transport_router.FillGraph(catalogue, graph);
+    });
+
+    transport_router::Graph transfer_graph;
+    measurements.Measure("fill_transfer_graph"s, 1, [&] {
+        transport_router.FillTransferGraph(catalogue, transfer_graph);
+    });
+
+    std::unique_ptr<transport_router::Router> router;
+    measurements.Measure("router_build"s, 1, [&router, &graph] {
+        router = std::make_unique<transport_router::Router>(graph, false);
+    });
+
+    if (settings.check_router != 0) {
+        std::unique_ptr<transport_router::Router> reference;
+        measurements.Measure("router_build_cells"s, 1, [&reference, &graph] {
+            reference = std::make_unique<transport_router::Router>(graph,
+                false, transport_router::Router::Kernel::CELLS);
+        });
+        if (!IsSameRoutes(*router, *reference)) {
+            throw std::runtime_error("Router kernels found different routes");
+        }
+    }
+
+    const auto route_ends = GetRouteEnds(catalogue,
+        stat_requests.at("Route"s));
+    MeasureRouteSearch(graph, *router, route_ends, measurements);
+    graph_models = MeasureTransferSearch(catalogue, transport_router,
+        settings, graph, transfer_graph, route_ends, measurements);
+
+    measurements.Measure("serialize"s, 1, [&] {
+        sm.Serialize(reader.GetRenderSettings(), settings.city.router_settings,
+            graph, *router);
+    });
+
+    transport_catalogue::TransportCatalogue loaded_catalogue;
+    serialization::SerializationMachine loaded_sm(loaded_catalogue);
+    std::istringstream process_requests_input(process_requests);
+    json_reader::JsonReader loaded_reader(loaded_catalogue, loaded_sm,
+        process_requests_input);
+    measurements.Measure("deserialize"s, 1, [&loaded_reader] {
+        loaded_reader.Deserialize();
+    });
+
+    // Each response is written as process_requests writes it, then all of
+    // them are printed as one array
+    std::vector<std::string> responses;
+    for (const std::string& type : {"Bus"s, "Stop"s, "Route"s,
+        "Route_alternatives"s, "Map"s}) {
+        const json::Array& requests = stat_requests.at(type);
+        measurements.Measure("query_"s + type, requests.size(), [&] {
+            for (const json::Node& request : requests) {
+                json::StringBuffer buffer(responses.emplace_back());
+                std::ostream stream(&buffer);
+                json::Writer writer(stream, json::ArrayPrinter::ITEM_INDENT);
+                loaded_reader.ProcessStatRequest(request, writer);
+            }
+        });
+    }
+
+    std::ostringstream output;
+    measurements.Measure("json_print"s, responses.size(),
+        [&responses, &output] {
+            json::ArrayPrinter printer(output);
+            for (const std::string& response : responses) {
+                printer.PrintItem(response);
+            }
+            printer.Finish();
+        });
+}
+
+json::Node RunBenchmarks(const BenchSettings& settings) {
+    synthetic_city::CityGenerator generator(settings.city);
+    const std::string make_base =
+        PrintToString(generator.MakeBaseRequests(settings.base_file));
+    const std::string process_requests = PrintToString(json::Builder{}
+        .StartDict().Key("serialization_settings"s)
+        .Value(synthetic_city::CityGenerator::MakeSerializationSettings(
+            settings.base_file))
+        .EndDict().Build());
+
+    std::map<std::string, json::Array> stat_requests;
+    for (const std::string& type : {"Bus"s, "Stop"s, "Route"s, "Map"s}) {
+        stat_requests[type] = generator.MakeStatRequests(type);
+    }
+    // The same Route requests, answered with alternatives by transfers
+    json::Array& alternatives = stat_requests["Route_alternatives"s];
+    for (const json::Node& request : stat_requests.at("Route"s)) {
+        json::Dict dict = request.AsDict();
+        dict["alternatives"s] = true;
+        alternatives.push_back(std::move(dict));
+    }
+
+    Measurements measurements;
+    json::Dict graph_models;
+    for (size_t i = 0; i < settings.repetitions; ++i) {
+        RunPipeline(settings, make_base, process_requests, stat_requests,
+            measurements, graph_models);
+    }
+    std::remove(settings.base_file.c_str());
+
+    const synthetic_city::CitySettings& city = settings.city;
+    return json::Builder{}.StartDict()
+        .Key("parameters"s).StartDict()
+            .Key("stops"s).Value(static_cast<int>(city.stop_count))
+            .Key("buses"s).Value(static_cast<int>(city.bus_count))
+            .Key("route_length"s).Value(static_cast<int>(city.route_length))
+            .Key("queries"s).Value(static_cast<int>(city.query_count))
+            .Key("map_queries"s).Value(static_cast<int>(city.map_query_count))
+            .Key("seed"s).Value(static_cast<int>(city.seed))
+            .Key("repetitions"s).Value(static_cast<int>(settings.repetitions))
+            .Key("min_plus_kernel"s)
+            .Value(std::string(min_plus::GetKernelName()))
+            .EndDict()
+        .Key("graphs"s).Value(std::move(graph_models))
+        .Key("results"s).Value(measurements.ToJson())
+        .EndDict().Build();
+}
+
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue_bench [--stops N] [--buses N]"sv
+              " [--route-length N]\n"sv
+           << "           [--queries N] [--map-queries N] [--seed N]"sv
+              " [--repetitions N]\n"sv
+           << "           [--base FILE] [--print make_base|process_requests]"sv
+              " [--check-router 0|1]\n"sv;
+}
+
+bool ParseArguments(int argc, char* argv[], BenchSettings& settings) {
+    std::map<std::string_view, size_t*> numbers = {
+        {"--stops"sv, &settings.city.stop_count},
+        {"--buses"sv, &settings.city.bus_count},
+        {"--route-length"sv, &settings.city.route_length},
+        {"--queries"sv, &settings.city.query_count},
+        {"--map-queries"sv, &settings.city.map_query_count},
+        {"--repetitions"sv, &settings.repetitions},
+        {"--check-router"sv, &settings.check_router},
+    };
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (const auto it = numbers.find(option); it != numbers.end()) {
+            *it->second = std::stoul(value);
+        } else if (option == "--seed"sv) {
+            settings.city.seed = static_cast<uint32_t>(std::stoul(value));
+        } else if (option == "--base"sv) {
+            settings.base_file = value;
+        } else if (option == "--print"sv
+            && (value == "make_base"sv || value == "process_requests"sv)) {
+            settings.print_mode = value;
+        } else {
+            return false;
+        }
+    }
+
+    return argc % 2 == 1 && settings.repetitions > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchSettings settings;
+    try {
+        if (!ParseArguments(argc, argv, settings)) {
+            PrintUsage();
+            return 1;
+        }
+    } catch (const std::logic_error&) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (settings.print_mode.empty()) {
+        json::Print(json::Document{RunBenchmarks(settings)}, std::cout);
+    } else {
+        synthetic_city::CityGenerator generator(settings.city);
+        json::Print(json::Document{settings.print_mode == "make_base"sv
+            ? generator.MakeBaseRequests(settings.base_file)
+            : generator.MakeProcessRequests(settings.base_file)}, std::cout);
+    }
+    std::cout << std::endl;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "graph.h"
+#include "search_workspace.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Dijkstra search from a single vertex that stops at max_weight, calling
+// on_settle(vertex, weight) for every reached vertex in non-decreasing
+// order of weights. Weights and last edges of the routes are left in the
+// workspace, a vertex that is not reached there has no route
+template <typename Weight, typename OnSettle>
+void SearchFrom(const DirectedWeightedGraph<Weight>& graph, VertexId from,
+    Weight max_weight, SearchWorkspace<Weight>& workspace, OnSettle on_settle)
+{
+    workspace.Reset(graph.GetVertexCount());
+    workspace.Reach(from, Weight{}, 0);
+    workspace.Push(Weight{}, from);
+    while (!workspace.IsQueueEmpty())
+    {
+        const auto [weight, vertex] = workspace.Pop();
+
+        if (workspace.IsSettled(vertex))
+        {
+            continue;
+        }
+        workspace.Settle(vertex);
+        on_settle(vertex, weight);
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            const auto& edge = graph.GetEdge(edge_id);
+            const Weight candidate = weight + edge.weight;
+
+            if (candidate <= max_weight && (!workspace.IsReached(edge.to)
+                || candidate < workspace.GetWeight(edge.to)))
+            {
+                workspace.Reach(edge.to, candidate, edge_id);
+                workspace.Push(candidate, edge.to);
+            }
+        }
+    }
+}
+
+// Dijkstra search from a single vertex that stops at max_weight.
+// Returns reached vertices with their weights in non-decreasing order.
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> ComputeReachableVertices(
+    const DirectedWeightedGraph<Weight>& graph, VertexId from,
+    Weight max_weight,
+    SearchWorkspace<Weight>& workspace = SearchWorkspace<Weight>::GetForThread())
+{
+    std::vector<std::pair<VertexId, Weight>> result;
+    SearchFrom(graph, from, max_weight, workspace,
+        [&result](VertexId vertex, Weight weight)
+        {
+            result.emplace_back(vertex, weight);
+        });
+
+    return result;
+}
+
+// Dijkstra search between two vertices that stops once the target is
+// settled. Puts edges of the route into a buffer owned by the caller and
+// returns its weight, or nothing if the target is unreachable
+template <typename Weight>
+std::optional<Weight> FindRoute(const DirectedWeightedGraph<Weight>& graph,
+    VertexId from, VertexId to, std::vector<EdgeId>& edges,
+    SearchWorkspace<Weight>& workspace = SearchWorkspace<Weight>::GetForThread())
+{
+    edges.clear();
+
+    workspace.Reset(graph.GetVertexCount());
+    workspace.Reach(from, Weight{}, 0);
+    workspace.Push(Weight{}, from);
+    while (!workspace.IsQueueEmpty())
+    {
+        const auto [weight, vertex] = workspace.Pop();
+
+        if (workspace.IsSettled(vertex))
+        {
+            continue;
+        }
+        workspace.Settle(vertex);
+
+        if (vertex == to)
+        {
+            for (VertexId current = to; current != from;
+                current = graph.GetEdge(workspace.GetPrevEdge(current)).from)
+            {
+                edges.push_back(workspace.GetPrevEdge(current));
+            }
+            std::reverse(edges.begin(), edges.end());
+
+            return weight;
+        }
+
+        for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+        {
+            const auto& edge = graph.GetEdge(edge_id);
+            const Weight candidate = weight + edge.weight;
+
+            if (!workspace.IsReached(edge.to)
+                || candidate < workspace.GetWeight(edge.to))
+            {
+                workspace.Reach(edge.to, candidate, edge_id);
+                workspace.Push(candidate, edge.to);
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+}  // namespace graph
@@ -1,25 +1,56 @@
 #pragma once
 
 #include "geo.h"
+#include "ranges.h"
 
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 namespace domain {
 
+// Names and stop lists live in the arenas of the catalogue
 struct Stop {
-    std::string name;
+    std::string_view name;
     geo::Coordinates coords;
     uint16_t edge_id;
 };
 
 struct Bus {
-    std::string name;
-    std::vector<Stop*> stops;
+    std::string_view name;
+    ranges::Span<Stop* const> stops;
     bool is_round;
+    std::vector<double> departures = {};
+};
+
+// Stop fields as separate columns indexed by stop id (Stop::edge_id), so
+// that scans over coordinates touch nothing but coordinates
+struct StopTable {
+    std::vector<double> lat;
+    std::vector<double> lng;
+    std::vector<std::string_view> names;
+
+    std::string_view GetName(size_t stop) const
+    {
+        return names[stop];
+    }
+};
+
+struct JourneyLeg {
+    const Stop* stop_from;
+    double wait_time;
+    const Bus* bus;
+    uint16_t span_count;
+    double ride_time;
+};
+
+struct Journey {
+    double total_time;
+    std::vector<JourneyLeg> legs;
 };
 
 struct StopRequest {
@@ -33,6 +64,12 @@ struct BusRequest {
     std::string name;
     std::vector<std::string> stops;
     bool is_round;
+    std::vector<double> departures;
+};
+
+struct RemoveRequest {
+    std::string type;
+    std::string name;
 };
 
 struct StatRequest {
@@ -46,12 +83,33 @@ struct RouteRequest {
     std::string type;
     std::string from;
     std::string to;
+    std::optional<double> departure_time;
+    bool alternatives = false;
+};
+
+struct IsochroneRequest {
+    int id;
+    std::string type;
+    std::string from;
+    double max_time;
+    bool render_map;
 };
 
+struct MatrixRequest {
+    int id;
+    std::string type;
+    std::vector<std::string> sources;
+    std::vector<std::string> targets;
+};
+
+using AnyStatRequest = std::variant<StatRequest, RouteRequest,
+    IsochroneRequest, MatrixRequest>;
+
 struct RequestQueue {
     std::vector<StopRequest> stops_requests;
     std::vector<BusRequest> buses_requests;
-    std::vector<std::variant<StatRequest, RouteRequest>> stats_requests;
+    std::vector<RemoveRequest> remove_requests;
+    std::vector<AnyStatRequest> stats_requests;
 };
 
 }
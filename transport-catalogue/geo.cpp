@@ -1,10 +1,134 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GEO_X86 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace geo {
 
+namespace {
+
+const double EARTH_RADIUS = 6371000;
+const double DR = M_PI / 180.;
+
+double ComputeCosine(const PointsTable& points, uint32_t from, uint32_t to) {
+    if (points.lat[from] == points.lat[to] && points.lng[from] == points.lng[to]) {
+        return 1.0;
+    }
+    return points.sin_lat[from] * points.sin_lat[to] + points.cos_lat[from]
+        * points.cos_lat[to] * (points.cos_lng[from] * points.cos_lng[to]
+        + points.sin_lng[from] * points.sin_lng[to]);
+}
+
+using CosinesKernel = void (*)(const PointsTable&, const uint32_t*,
+    const uint32_t*, size_t, double*);
+
+void ComputeCosinesScalar(const PointsTable& points, const uint32_t* from,
+    const uint32_t* to, size_t count, double* cosines) {
+    for (size_t i = 0; i < count; ++i) {
+        cosines[i] = ComputeCosine(points, from[i], to[i]);
+    }
+}
+
+#if defined(__SSE2__)
+
+void ComputeCosinesSse2(const PointsTable& points, const uint32_t* from,
+    const uint32_t* to, size_t count, double* cosines) {
+    const auto gather = [](const std::vector<double>& values, const uint32_t* ids) {
+        return _mm_set_pd(values[ids[1]], values[ids[0]]);
+    };
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d same = _mm_and_pd(
+            _mm_cmpeq_pd(gather(points.lat, from + i), gather(points.lat, to + i)),
+            _mm_cmpeq_pd(gather(points.lng, from + i), gather(points.lng, to + i)));
+
+        const __m128d cos_dlng = _mm_add_pd(
+            _mm_mul_pd(gather(points.cos_lng, from + i), gather(points.cos_lng, to + i)),
+            _mm_mul_pd(gather(points.sin_lng, from + i), gather(points.sin_lng, to + i)));
+        const __m128d cosine = _mm_add_pd(
+            _mm_mul_pd(gather(points.sin_lat, from + i), gather(points.sin_lat, to + i)),
+            _mm_mul_pd(_mm_mul_pd(gather(points.cos_lat, from + i),
+                gather(points.cos_lat, to + i)), cos_dlng));
+
+        _mm_storeu_pd(cosines + i, _mm_or_pd(_mm_and_pd(same, _mm_set1_pd(1.0)),
+            _mm_andnot_pd(same, cosine)));
+    }
+
+    ComputeCosinesScalar(points, from + i, to + i, count - i, cosines + i);
+}
+
+#endif
+
+#ifdef GEO_X86
+
+__attribute__((target("avx2")))
+inline __m256d GatherAvx2(const std::vector<double>& values, __m128i ids) {
+    return _mm256_i32gather_pd(values.data(), ids, sizeof(double));
+}
+
+__attribute__((target("avx2")))
+void ComputeCosinesAvx2(const PointsTable& points, const uint32_t* from,
+    const uint32_t* to, size_t count, double* cosines) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i from_ids = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(from + i));
+        const __m128i to_ids = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(to + i));
+
+        const __m256d same = _mm256_and_pd(
+            _mm256_cmp_pd(GatherAvx2(points.lat, from_ids),
+                GatherAvx2(points.lat, to_ids), _CMP_EQ_OQ),
+            _mm256_cmp_pd(GatherAvx2(points.lng, from_ids),
+                GatherAvx2(points.lng, to_ids), _CMP_EQ_OQ));
+
+        const __m256d cos_dlng = _mm256_add_pd(
+            _mm256_mul_pd(GatherAvx2(points.cos_lng, from_ids),
+                GatherAvx2(points.cos_lng, to_ids)),
+            _mm256_mul_pd(GatherAvx2(points.sin_lng, from_ids),
+                GatherAvx2(points.sin_lng, to_ids)));
+        const __m256d cosine = _mm256_add_pd(
+            _mm256_mul_pd(GatherAvx2(points.sin_lat, from_ids),
+                GatherAvx2(points.sin_lat, to_ids)),
+            _mm256_mul_pd(_mm256_mul_pd(GatherAvx2(points.cos_lat, from_ids),
+                GatherAvx2(points.cos_lat, to_ids)), cos_dlng));
+
+        _mm256_storeu_pd(cosines + i,
+            _mm256_blendv_pd(cosine, _mm256_set1_pd(1.0), same));
+    }
+
+    ComputeCosinesScalar(points, from + i, to + i, count - i, cosines + i);
+}
+
+#endif
+
+// AVX2 is picked at run time, as the build targets the baseline instruction
+// set; SSE2 is part of that baseline on x86-64
+CosinesKernel PickCosinesKernel() {
+#ifdef GEO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &ComputeCosinesAvx2;
+    }
+#endif
+#if defined(__SSE2__)
+    return &ComputeCosinesSse2;
+#else
+    return &ComputeCosinesScalar;
+#endif
+}
+
+}
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     if (from == to) {
@@ -15,4 +139,34 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr)) * 6371000;
 }
 
+PointsTable MakePointsTable(const std::vector<double>& lats,
+    const std::vector<double>& lngs) {
+    PointsTable points{lats, lngs, {}, {}, {}, {}};
+
+    const size_t count = lats.size();
+    points.sin_lat.resize(count);
+    points.cos_lat.resize(count);
+    points.sin_lng.resize(count);
+    points.cos_lng.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        points.sin_lat[i] = std::sin(lats[i] * DR);
+        points.cos_lat[i] = std::cos(lats[i] * DR);
+        points.sin_lng[i] = std::sin(lngs[i] * DR);
+        points.cos_lng[i] = std::cos(lngs[i] * DR);
+    }
+
+    return points;
+}
+
+void ComputeDistances(const PointsTable& points, const uint32_t* from,
+    const uint32_t* to, size_t count, double* distances) {
+    static const CosinesKernel kernel = PickCosinesKernel();
+
+    kernel(points, from, to, count, distances);
+    for (size_t i = 0; i < count; ++i) {
+        distances[i] = std::acos(std::clamp(distances[i], -1.0, 1.0)) * EARTH_RADIUS;
+    }
+}
+
 }
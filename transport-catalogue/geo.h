@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 namespace geo {
 
 struct Coordinates {
@@ -17,6 +21,25 @@ struct Coordinates {
     }
 };
 
+// Struct-of-arrays table of points with precomputed sines and cosines,
+// so that batch distance computation needs no trigonometry per point
+struct PointsTable {
+    std::vector<double> lat;
+    std::vector<double> lng;
+    std::vector<double> sin_lat;
+    std::vector<double> cos_lat;
+    std::vector<double> sin_lng;
+    std::vector<double> cos_lng;
+};
+
 double ComputeDistance(Coordinates from, Coordinates to);
 
+PointsTable MakePointsTable(const std::vector<double>& lats,
+    const std::vector<double>& lngs);
+
+// Writes distance between points from[i] and to[i] of the table into
+// distances[i] for every i in [0, count)
+void ComputeDistances(const PointsTable& points, const uint32_t* from,
+    const uint32_t* to, size_t count, double* distances);
+
 }
@@ -2,9 +2,12 @@
 
 #include "ranges.h"
 
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <optional>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -13,6 +16,38 @@ namespace graph {
 using VertexId = size_t;
 using EdgeId = size_t;
 
+// Converts weights to and from minutes, which requests and responses are
+// given in. Floating-point weights are minutes themselves
+template <typename Weight, typename = void>
+struct WeightTraits {
+    static Weight FromMinutes(double minutes)
+    {
+        return static_cast<Weight>(minutes);
+    }
+
+    static double ToMinutes(Weight weight)
+    {
+        return static_cast<double>(weight);
+    }
+};
+
+// Integer weights are fixed-point deciseconds, so that sums of them are
+// exact and compared as integers
+template <typename Weight>
+struct WeightTraits<Weight, std::enable_if_t<std::is_integral_v<Weight>>> {
+    static constexpr double UNITS_PER_MINUTE = 600.0;
+
+    static Weight FromMinutes(double minutes)
+    {
+        return static_cast<Weight>(std::llround(minutes * UNITS_PER_MINUTE));
+    }
+
+    static double ToMinutes(Weight weight)
+    {
+        return static_cast<double>(weight) / UNITS_PER_MINUTE;
+    }
+};
+
 template <typename Weight>
 struct Edge {
     VertexId from;
@@ -46,6 +81,11 @@ private:
     std::vector<IncidenceList> incidence_lists_;
 };
 
+struct EdgesDiff {
+    std::vector<std::optional<EdgeId>> previous_to_current;
+    std::vector<EdgeId> added;
+};
+
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
     : incidence_lists_(vertex_count)
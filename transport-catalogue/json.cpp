@@ -226,15 +226,25 @@ struct PrintContext {
     std::ostream& out;
     int indent_step = 4;
     int indent = 0;
+    bool is_compact = false;
 
     void PrintIndent() const {
+        if (is_compact) {
+            return;
+        }
         for (int i = 0; i < indent; ++i) {
             out.put(' ');
         }
     }
 
+    void PrintLineBreak() const {
+        if (!is_compact) {
+            out.put('\n');
+        }
+    }
+
     PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+        return {out, indent_step, indent_step + indent, is_compact};
     }
 };
 
@@ -245,7 +255,7 @@ void PrintValue(const Value& value, const PrintContext& ctx) {
     ctx.out << value;
 }
 
-void PrintString(const std::string& value, std::ostream& out) {
+void PrintString(std::string_view value, std::ostream& out) {
     out.put('"');
     for (const char c : value) {
         switch (c) {
@@ -291,19 +301,21 @@ void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
 template <>
 void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
     std::ostream& out = ctx.out;
-    out << "[\n"sv;
+    out.put('[');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const Node& node : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put(']');
 }
@@ -311,21 +323,23 @@ void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
 template <>
 void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
     std::ostream& out = ctx.out;
-    out << "{\n"sv;
+    out.put('{');
+    ctx.PrintLineBreak();
     bool first = true;
     auto inner_ctx = ctx.Indented();
     for (const auto& [key, node] : nodes) {
         if (first) {
             first = false;
         } else {
-            out << ",\n"sv;
+            out.put(',');
+            ctx.PrintLineBreak();
         }
         inner_ctx.PrintIndent();
         PrintString(key, ctx.out);
-        out << ": "sv;
+        out << (ctx.is_compact ? ":"sv : ": "sv);
         PrintNode(node, inner_ctx);
     }
-    out.put('\n');
+    ctx.PrintLineBreak();
     ctx.PrintIndent();
     out.put('}');
 }
@@ -344,8 +358,194 @@ Document Load(std::istream& input) {
     return Document{LoadNode(input)};
 }
 
+void LoadDictItems(std::istream& input,
+    const std::function<void(std::string key, Node value)>& on_item) {
+    char c;
+    if (!(input >> c) || c != '{') {
+        throw ParsingError("Dictionary is expected"s);
+    }
+
+    std::set<std::string> keys;
+    while (input >> c && c != '}') {
+        if (c == '"') {
+            std::string key = LoadString(input).AsString();
+            if (!(input >> c && c == ':')) {
+                throw ParsingError(": is expected but '"s + c + "' has been found"s);
+            }
+            if (!keys.insert(key).second) {
+                throw ParsingError("Duplicate key '"s + key + "' have been found");
+            }
+            on_item(std::move(key), LoadNode(input));
+        } else if (c != ',') {
+            throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+        }
+    }
+    if (!input) {
+        throw ParsingError("Dictionary parsing error"s);
+    }
+}
+
 void Print(const Document& doc, std::ostream& output) {
     PrintNode(doc.GetRoot(), PrintContext{output});
 }
 
+void PrintCompact(const Document& doc, std::ostream& output) {
+    PrintNode(doc.GetRoot(), PrintContext{output, 0, 0, true});
+}
+
+Writer& Writer::StartDict() {
+    StartContainer('{');
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    EndContainer('}');
+    return *this;
+}
+
+Writer& Writer::StartArray() {
+    StartContainer('[');
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    EndContainer(']');
+    return *this;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    if (depth_ == 0 || is_after_key_) {
+        throw std::logic_error("Key is not expected"s);
+    }
+    StartItem();
+    PrintString(key, output_);
+    output_ << (is_compact_ ? ":"sv : ": "sv);
+    is_after_key_ = true;
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    StartItem();
+    output_ << "null"sv;
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    StartItem();
+    output_ << (value ? "true"sv : "false"sv);
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    StartItem();
+    output_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    StartItem();
+    output_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    StartItem();
+    PrintString(value, output_);
+    return *this;
+}
+
+Writer& Writer::Value(const std::string& value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const Node& node) {
+    StartItem();
+    PrintNode(node, PrintContext{output_, 4, indent_ + 4 * depth_, is_compact_});
+    return *this;
+}
+
+// Prints what goes before a value or a key: a separator and the indent of
+// an item, unless the value follows its key
+void Writer::StartItem() {
+    if (is_after_key_) {
+        is_after_key_ = false;
+        return;
+    }
+    if (depth_ == 0) {
+        return;
+    }
+    if (!is_empty_[depth_]) {
+        output_.put(',');
+        PrintLineBreak();
+    }
+    is_empty_[depth_] = false;
+    PrintIndent(depth_);
+}
+
+void Writer::StartContainer(char bracket) {
+    if (depth_ == MAX_DEPTH) {
+        throw std::logic_error("Too deep nesting"s);
+    }
+    StartItem();
+    output_.put(bracket);
+    PrintLineBreak();
+    is_empty_[++depth_] = true;
+}
+
+void Writer::EndContainer(char bracket) {
+    if (depth_ == 0 || is_after_key_) {
+        throw std::logic_error("Nothing to close"s);
+    }
+    PrintLineBreak();
+    PrintIndent(--depth_);
+    output_.put(bracket);
+}
+
+void Writer::PrintLineBreak() const {
+    if (!is_compact_) {
+        output_.put('\n');
+    }
+}
+
+void Writer::PrintIndent(int depth) const {
+    if (is_compact_) {
+        return;
+    }
+    for (int i = 0; i < indent_ + 4 * depth; ++i) {
+        output_.put(' ');
+    }
+}
+
+StringBuffer::int_type StringBuffer::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        text_.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize StringBuffer::xsputn(const char* s, std::streamsize count) {
+    text_.append(s, static_cast<size_t>(count));
+    return count;
+}
+
+void ArrayPrinter::PrintItem(std::string_view item) {
+    output_ << (is_empty_ ? "[\n"sv : ",\n"sv)
+        << "    "sv.substr(0, ITEM_INDENT) << item;
+    is_empty_ = false;
+}
+
+void ArrayPrinter::Finish() {
+    const PrintContext ctx{output_};
+    if (is_empty_) {
+        output_.put('[');
+        ctx.PrintLineBreak();
+    }
+    ctx.PrintLineBreak();
+    output_.put(']');
+}
+
 }  // namespace json
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <array>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -143,6 +148,98 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
 
 Document Load(std::istream& input);
 
+// Loads a top-level dictionary passing its items to on_item as soon as
+// each one is read, so the caller may act before the rest of the input
+void LoadDictItems(std::istream& input,
+    const std::function<void(std::string key, Node value)>& on_item);
+
 void Print(const Document& doc, std::ostream& output);
 
+// Prints the document on a single line without indentation
+void PrintCompact(const Document& doc, std::ostream& output);
+
+// Prints a value in the layout of Print as it is written, without building
+// nodes, so that a response needs no allocation of its own. Keys must be
+// written in ascending order, as Print puts those of a Dict
+class Writer {
+public:
+    static constexpr int MAX_DEPTH = 16;
+
+    // indent is that of the line the value is printed on
+    explicit Writer(std::ostream& output, int indent = 0, bool is_compact = false)
+        : output_(output)
+        , indent_(indent)
+        , is_compact_(is_compact) {
+    }
+
+    Writer& StartDict();
+    Writer& EndDict();
+    Writer& StartArray();
+    Writer& EndArray();
+    Writer& Key(std::string_view key);
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const std::string& value);
+    Writer& Value(const char* value);
+    Writer& Value(const Node& node);
+
+private:
+    std::ostream& output_;
+    int indent_;
+    bool is_compact_;
+    int depth_ = 0;
+    // Whether the container open at each depth has no items yet
+    std::array<bool, MAX_DEPTH + 1> is_empty_{};
+    bool is_after_key_ = false;
+
+    void StartItem();
+    void StartContainer(char bracket);
+    void EndContainer(char bracket);
+    void PrintLineBreak() const;
+    void PrintIndent(int depth) const;
+};
+
+// Stream buffer appending to a string. Unlike std::ostringstream it hands
+// out no copies and the string keeps its capacity when cleared, so one
+// string may be refilled for every response without allocating
+class StringBuffer : public std::streambuf {
+public:
+    explicit StringBuffer(std::string& text)
+        : text_(text) {
+    }
+
+protected:
+    int_type overflow(int_type c) override;
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override;
+
+private:
+    std::string& text_;
+};
+
+// Prints array items one by one in the same layout as Print. Each item is
+// written at once, since a stream synced with stdio locks on every
+// character once the program has threads
+class ArrayPrinter {
+public:
+    // Indent of the items, which a Writer printing one has to be given
+    static constexpr int ITEM_INDENT = 4;
+
+    explicit ArrayPrinter(std::ostream& output)
+        : output_(output) {
+    }
+
+    void PrintItem(std::string_view item);
+
+    void Finish();
+
+private:
+    std::ostream& output_;
+    bool is_empty_ = true;
+};
+
 }  // namespace json
@@ -4,16 +4,58 @@ using namespace std::literals;
 
 namespace json_reader {
 
+namespace {
+
+std::string_view GetRequestType(const domain::AnyStatRequest& request)
+{
+    if (std::holds_alternative<domain::StatRequest>(request))
+    {
+        return std::get<domain::StatRequest>(request).type;
+    }
+    else if (std::holds_alternative<domain::RouteRequest>(request))
+    {
+        return "Route"sv;
+    }
+    else if (std::holds_alternative<domain::IsochroneRequest>(request))
+    {
+        return "Isochrone"sv;
+    }
+
+    return "Matrix"sv;
+}
+
+int GetRequestId(const domain::AnyStatRequest& request)
+{
+    return std::visit([](const auto& typed_request)
+        {
+            return typed_request.id;
+        }, request);
+}
+
+}
+
 JsonReader::JsonReader(TransportCatalogue& catalogue,
-    serialization::SerializationMachine& sm, std::istream& input)
+    serialization::SerializationMachine& sm, std::istream& input,
+    stats::Stats* stats)
     : catalogue_(catalogue)
     , serialization_machine_(sm)
+    , stats_(stats)
 {
     JsonReader::ParseJSON(input);
 }
 
+JsonReader::JsonReader(TransportCatalogue& catalogue,
+    serialization::SerializationMachine& sm, stats::Stats* stats)
+    : catalogue_(catalogue)
+    , serialization_machine_(sm)
+    , stats_(stats)
+{
+}
+
 void JsonReader::UpdateCatalogue()
 {
+    const stats::ScopedTimer timer(stats_, "update_catalogue"s);
+
     if (!request_queue_.stops_requests.empty())
     {
         for (const domain::StopRequest& request : request_queue_.stops_requests)
@@ -34,32 +76,207 @@ void JsonReader::UpdateCatalogue()
             ProcessingBusRequest(request);
         }
     }
+
+    catalogue_.IndexStopBuses();
+    catalogue_.ComputeGeoLengths();
 }
 
 void JsonReader::Serialize()
 {
-    graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(
-        catalogue_.GetAllStops().size());
-    transport_router::TransportRouter tr_temp(router_settings_);
-    tr_temp.FillGraph(catalogue_, *graph_);
-    router_ = std::make_unique<graph::Router<double>>(*graph_, false);
+    if (router_settings_.graph_model == transport_router::GraphModel::TRANSFER)
+    {
+        // The transfer graph is built when the base is loaded and searched
+        // per request, so the classic graph and its router stay empty
+        graph_ = std::make_unique<transport_router::Graph>();
+        router_ = std::make_unique<transport_router::Router>(*graph_, true);
+    }
+    else
+    {
+        {
+            const stats::ScopedTimer timer(stats_, "fill_graph"s);
+            graph_ = std::make_unique<transport_router::Graph>(
+                catalogue_.GetAllStops().size());
+            transport_router::TransportRouter tr_temp(router_settings_);
+            tr_temp.FillGraph(catalogue_, *graph_);
+        }
 
+        const stats::ScopedTimer timer(stats_, "router_build"s);
+        router_ = std::make_unique<transport_router::Router>(*graph_, false);
+    }
+
+    const stats::ScopedTimer timer(stats_, "serialize"s);
     serialization_machine_.Serialize(render_settings_, router_settings_,
         *graph_, *router_);
 }
 
 void JsonReader::Deserialize()
 {
-    graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>();
-    router_ = std::make_unique<graph::Router<double>>(*graph_, true);
+    {
+        const stats::ScopedTimer timer(stats_, "deserialize"s);
+        graph_ = std::make_unique<transport_router::Graph>();
+        router_ = std::make_unique<transport_router::Router>(*graph_, true);
+
+        serialization_machine_.Deserialize(render_settings_, router_settings_,
+            *graph_, *router_);
+
+        catalogue_.ComputeGeoLengths();
+    }
+
+    const stats::ScopedTimer timer(stats_, "build_journey_routers"s);
+    timetable_router_ = std::make_unique<timetable_router::TimetableRouter>(
+        catalogue_, router_settings_);
+    raptor_router_ = std::make_unique<raptor_router::RaptorRouter>(
+        catalogue_, router_settings_);
+
+    if (router_settings_.graph_model == transport_router::GraphModel::TRANSFER)
+    {
+        transfer_graph_ = std::make_unique<transport_router::Graph>();
+        transport_router::TransportRouter(router_settings_).FillTransferGraph(
+            catalogue_, *transfer_graph_);
+    }
+}
+
+void JsonReader::UpdateBase()
+{
+    timetable_router_ = nullptr;
+    raptor_router_ = nullptr;
+    transfer_graph_ = nullptr;
+
+    const BaseDelta delta = MergeBaseRequests();
+    catalogue_ = TransportCatalogue{};
+    UpdateCatalogue();
+
+    if (router_settings_.graph_model == transport_router::GraphModel::TRANSFER)
+    {
+        // Nothing is stored for routing, as in make_base
+        const stats::ScopedTimer timer(stats_, "serialize"s);
+        serialization_machine_.Serialize(render_settings_, router_settings_,
+            *graph_, *router_);
 
-    serialization_machine_.Deserialize(render_settings_, router_settings_,
+        return;
+    }
+
+    transport_router::Graph graph;
+    graph::EdgesDiff edges_diff;
+    {
+        const stats::ScopedTimer timer(stats_, "update_graph"s);
+        transport_router::TransportRouter tr_temp(router_settings_);
+        edges_diff = tr_temp.UpdateGraph(catalogue_, *graph_,
+            delta.vertex_ids, delta.changed_buses, graph);
+    }
+
+    // The router reads routes of the previous graph by the new edge ids
+    // and updates each row as the serializer asks for it. A removed stop
+    // renumbers the vertices, so then all routes are built anew
+    std::optional<stats::ScopedTimer> timer;
+    timer.emplace(stats_, "update_routes"s);
+    *graph_ = std::move(graph);
+    if (delta.is_vertices_kept)
+    {
+        router_->UpdateRoutes(edges_diff);
+    }
+    else
+    {
+        router_ = std::make_unique<transport_router::Router>(*graph_, false);
+    }
+
+    timer.emplace(stats_, "serialize"s);
+    serialization_machine_.Serialize(render_settings_, router_settings_,
         *graph_, *router_);
 }
 
 void JsonReader::PrintStat(std::ostream& output)
 {
-    json::Print(json::Document{ComputeJSON()}, output);
+    std::optional<stats::ScopedTimer> timer;
+    timer.emplace(stats_, "compute_responses"s);
+    std::string responses;
+    json::StringBuffer buffer(responses);
+    std::ostream stream(&buffer);
+    json::Writer writer(stream);
+    writer.StartArray();
+    for (const auto& request : request_queue_.stats_requests)
+    {
+        ComputeTimedRequest(writer, request);
+    }
+    writer.EndArray();
+
+    timer.emplace(stats_, "print_responses"s);
+    output << responses;
+}
+
+void JsonReader::ProcessRequests(std::istream& input, std::ostream& output)
+{
+    std::optional<stats::ScopedTimer> timer;
+    timer.emplace(stats_, "parse_input"s);
+
+    std::future<void> deserialization;
+    json::LoadDictItems(input, [this, &deserialization](std::string key,
+        json::Node value)
+        {
+            if (key == "serialization_settings")
+            {
+                ParseSerializationSettings(value);
+                deserialization = std::async(std::launch::async,
+                    [this] { Deserialize(); });
+            }
+            else if (key == "stat_requests")
+            {
+                ParseStatRequests(value);
+            }
+        });
+
+    timer.reset();
+
+    if (deserialization.valid())
+    {
+        deserialization.get();
+    }
+    else
+    {
+        Deserialize();
+    }
+
+    timer.emplace(stats_, "answer_requests"s);
+    ResponseQueue queue;
+    std::thread computer([this, &queue] { ComputeResponses(queue); });
+
+    json::ArrayPrinter printer(output);
+    std::string response;
+    while (true)
+    {
+        std::unique_lock lock(queue.mutex);
+        queue.cv.wait(lock, [&queue]
+            {
+                return queue.is_computed || queue.count > 0;
+            });
+
+        if (queue.count == 0)
+        {
+            break;
+        }
+
+        // The printed text goes back to the ring, keeping its capacity
+        response.swap(queue.responses[queue.first]);
+        queue.first = (queue.first + 1) % queue.responses.size();
+        --queue.count;
+        lock.unlock();
+        queue.cv.notify_all();
+
+        printer.PrintItem(response);
+    }
+
+    computer.join();
+    if (queue.error)
+    {
+        std::rethrow_exception(queue.error);
+    }
+    printer.Finish();
+}
+
+void JsonReader::ProcessStatRequest(const json::Node& stat_request,
+    json::Writer& writer) const
+{
+    ComputeTimedRequest(writer, ParseStatRequest(stat_request));
 }
 
 const domain::RequestQueue& JsonReader::GetRequestQueue() const
@@ -72,6 +289,12 @@ map_renderer::RenderSettingsRequest JsonReader::GetRenderSettings() const
     return render_settings_;
 }
 
+const serialization::SerializationSettings&
+JsonReader::GetSerializationSettings() const
+{
+    return serialization_machine_.GetSettings();
+}
+
 void JsonReader::ParseStopRequest(const json::Node& stop_request)
 {
     const json::Dict& request = stop_request.AsDict();
@@ -93,6 +316,50 @@ void JsonReader::ParseStopRequest(const json::Node& stop_request)
     request_queue_.stops_requests.push_back({name, lat, lng, dists});
 }
             
+std::vector<double> JsonReader::ParseTimetable(const json::Node& timetable)
+{
+    const json::Dict& request = timetable.AsDict();
+
+    std::vector<double> departures = {};
+    if (request.count("departures"))
+    {
+        for (const json::Node& departure : request.at("departures").AsArray())
+        {
+            departures.push_back(departure.AsDouble());
+        }
+    }
+
+    if (request.count("headways"))
+    {
+        for (const json::Node& headway : request.at("headways").AsArray())
+        {
+            const json::Dict& window = headway.AsDict();
+            const double start = window.at("start").AsDouble();
+            const double end = window.at("end").AsDouble();
+            const double interval = window.at("interval").AsDouble();
+
+            if (interval <= 0.0)
+            {
+                throw std::logic_error("Invalid interval in bus timetable");
+            }
+
+            // Each departure is computed from the start, so that rounding
+            // errors of the interval do not add up over a long window
+            if (start <= end)
+            {
+                const size_t count = static_cast<size_t>(
+                    std::floor((end - start) / interval + 1e-9)) + 1;
+                for (size_t k = 0; k < count; ++k)
+                {
+                    departures.push_back(start + k * interval);
+                }
+            }
+        }
+    }
+
+    return departures;
+}
+
 void JsonReader::ParseBusRequest(const json::Node& bus_request)
 {
     const json::Dict& request = bus_request.AsDict();
@@ -106,7 +373,22 @@ void JsonReader::ParseBusRequest(const json::Node& bus_request)
         stops.push_back(stop.AsString());
     }
 
-    request_queue_.buses_requests.push_back({name, stops, is_round});
+    std::vector<double> departures = {};
+    if (request.count("timetable"))
+    {
+        departures = ParseTimetable(request.at("timetable"));
+    }
+
+    request_queue_.buses_requests.push_back({name, stops, is_round,
+        departures});
+}
+
+void JsonReader::ParseRemoveRequest(const json::Node& remove_request)
+{
+    const json::Dict& request = remove_request.AsDict();
+
+    request_queue_.remove_requests.push_back({request.at("type").AsString(),
+        request.at("name").AsString()});
 }
 
 void JsonReader::ParseBaseRequests(const json::Node& base_requests)
@@ -115,6 +397,13 @@ void JsonReader::ParseBaseRequests(const json::Node& base_requests)
 
     for (const json::Node& request : requests)
     {
+        if (request.AsDict().count("action")
+            && request.AsDict().at("action").AsString() == "remove")
+        {
+            ParseRemoveRequest(request);
+            continue;
+        }
+
         if (request.AsDict().at("type").AsString() == "Stop")
         {
             ParseStopRequest(request);
@@ -129,25 +418,86 @@ void JsonReader::ParseBaseRequests(const json::Node& base_requests)
     }
 }
 
-void JsonReader::ParseRouteRequest(const json::Dict& route_request)
+domain::RouteRequest JsonReader::ParseRouteRequest(
+    const json::Dict& route_request) const
 {
     const int id = route_request.at("id").AsInt();
     const std::string type = route_request.at("type").AsString();
     const std::string from = route_request.at("from").AsString();
     const std::string to = route_request.at("to").AsString();
 
-    domain::RouteRequest temp{id, type, from, to};
-    request_queue_.stats_requests.push_back(std::move(temp));
+    std::optional<double> departure_time;
+    if (route_request.count("departure_time"))
+    {
+        departure_time = route_request.at("departure_time").AsDouble();
+    }
+
+    bool alternatives = false;
+    if (route_request.count("alternatives"))
+    {
+        alternatives = route_request.at("alternatives").AsBool();
+    }
+
+    return domain::RouteRequest{id, type, from, to, departure_time,
+        alternatives};
+}
+
+domain::IsochroneRequest JsonReader::ParseIsochroneRequest(
+    const json::Dict& isochrone_request) const
+{
+    const int id = isochrone_request.at("id").AsInt();
+    const std::string type = isochrone_request.at("type").AsString();
+    const std::string from = isochrone_request.at("from").AsString();
+    const double max_time = isochrone_request.at("max_time").AsDouble();
+
+    bool render_map = false;
+    if (isochrone_request.count("render_map"))
+    {
+        render_map = isochrone_request.at("render_map").AsBool();
+    }
+
+    return domain::IsochroneRequest{id, type, from, max_time, render_map};
 }
 
-void JsonReader::ParseStatRequest(const json::Node& stat_request)
+domain::MatrixRequest JsonReader::ParseMatrixRequest(
+    const json::Dict& matrix_request) const
+{
+    const int id = matrix_request.at("id").AsInt();
+    const std::string type = matrix_request.at("type").AsString();
+
+    std::vector<std::string> sources = {};
+    for (const json::Node& stop : matrix_request.at("sources").AsArray())
+    {
+        sources.push_back(stop.AsString());
+    }
+
+    std::vector<std::string> targets = {};
+    for (const json::Node& stop : matrix_request.at("targets").AsArray())
+    {
+        targets.push_back(stop.AsString());
+    }
+
+    return domain::MatrixRequest{id, type, sources, targets};
+}
+
+domain::AnyStatRequest JsonReader::ParseStatRequest(
+    const json::Node& stat_request) const
 {
     const json::Dict& request = stat_request.AsDict();
 
     if (request.at("type") == "Route")
     {
-        ParseRouteRequest(request);
-        return;
+        return ParseRouteRequest(request);
+    }
+
+    if (request.at("type") == "Isochrone")
+    {
+        return ParseIsochroneRequest(request);
+    }
+
+    if (request.at("type") == "Matrix")
+    {
+        return ParseMatrixRequest(request);
     }
 
     const int id = request.at("id").AsInt();
@@ -156,14 +506,10 @@ void JsonReader::ParseStatRequest(const json::Node& stat_request)
     if (request.count("name") != 0)
     {
         const std::string name = request.at("name").AsString();
-        domain::StatRequest temp{id, type, name};
-        request_queue_.stats_requests.push_back(std::move(temp));
-
-        return;
+        return domain::StatRequest{id, type, name};
     }
 
-    domain::StatRequest temp{id, type, ""};
-    request_queue_.stats_requests.push_back(std::move(temp));
+    return domain::StatRequest{id, type, ""};
 }
 
 void JsonReader::ParseStatRequests(const json::Node& stat_requests)
@@ -172,7 +518,7 @@ void JsonReader::ParseStatRequests(const json::Node& stat_requests)
 
     for (const json::Node& request : requests)
     {
-        ParseStatRequest(request);
+        request_queue_.stats_requests.push_back(ParseStatRequest(request));
     }
 }
 
@@ -265,6 +611,21 @@ void JsonReader::ParseRoutingSettings(const json::Node& routing_settings)
 
     router_settings_.bus_wait_time = static_cast<uint16_t>(wait_time);
     router_settings_.bus_velocity = velocity;
+
+    if (request.count("graph_model"))
+    {
+        const std::string& graph_model = request.at("graph_model").AsString();
+
+        if (graph_model == "transfer")
+        {
+            router_settings_.graph_model =
+                transport_router::GraphModel::TRANSFER;
+        }
+        else if (graph_model != "classic")
+        {
+            throw std::logic_error("Invalid value in router_settings");
+        }
+    }
 }
 
 void JsonReader::ParseSerializationSettings(
@@ -272,16 +633,26 @@ void JsonReader::ParseSerializationSettings(
 {
     const json::Dict& request = serialization_settings.AsDict();    
 
-    std::string file_name_temp = request.at("file").AsString();
+    serialization::SerializationSettings settings;
+    settings.file_name = request.at("file").AsString();
+    if (request.count("router_cache_mb"))
+    {
+        settings.router_cache_size =
+            static_cast<size_t>(request.at("router_cache_mb").AsInt()) << 20;
+    }
 
-    serialization_machine_.SetSettings(file_name_temp);
+    serialization_machine_.SetSettings(settings);
 }
 
 void JsonReader::ParseJSON(std::istream& input)
 {
+    std::optional<stats::ScopedTimer> timer;
+    timer.emplace(stats_, "json_load"s);
     const json::Document json_data = json::Load(input);
     const json::Dict& requests = json_data.GetRoot().AsDict();
 
+    timer.emplace(stats_, "parse_requests"s);
+
     if (requests.count("base_requests"))
     {
         ParseBaseRequests(requests.at("base_requests"));
@@ -326,34 +697,185 @@ void JsonReader::ProcessingDistances(const domain::StopRequest& request)
 
 void JsonReader::ProcessingBusRequest(const domain::BusRequest& request)
 {
-    std::vector<std::string> stops = request.stops;
+    // Views into the request, so that no stop name is copied
+    std::vector<std::string_view> stops;
+    stops.reserve(request.stops.size() * 2);
+    stops.insert(stops.end(), request.stops.begin(), request.stops.end());
     if (!request.is_round)
     {
-        for (auto it = std::next(request.stops.rbegin(), 1);
-            it != request.stops.rend(); ++it)
+        stops.insert(stops.end(), std::next(request.stops.rbegin(), 1),
+            request.stops.rend());
+    }
+
+    catalogue_.AddBus(request.name, stops, request.is_round);
+
+    if (!request.departures.empty())
+    {
+        catalogue_.AddDepartures(request.name, request.departures);
+    }
+}
+
+JsonReader::BaseDelta JsonReader::MergeBaseRequests()
+{
+    BaseDelta delta;
+
+    std::vector<domain::StopRequest> stops;
+    std::unordered_map<std::string, size_t> stop_index;
+    for (const domain::Stop& stop : catalogue_.GetAllStops())
+    {
+        stop_index[std::string(stop.name)] = stops.size();
+        stops.push_back({std::string(stop.name), stop.coords.lat,
+            stop.coords.lng, {}});
+    }
+    for (const auto& [from_to, distance] : catalogue_.GetStopsToDistance())
+    {
+        stops[stop_index.at(std::string(from_to.first->name))]
+            .dists[std::string(from_to.second->name)] = distance;
+    }
+
+    std::vector<domain::BusRequest> buses;
+    std::unordered_map<std::string, size_t> bus_index;
+    for (const domain::Bus& bus : catalogue_.GetAllBuses())
+    {
+        const size_t stops_count = bus.is_round ? bus.stops.size()
+            : (bus.stops.size() + 1) / 2;
+
+        std::vector<std::string> bus_stops;
+        for (size_t i = 0; i < stops_count; ++i)
         {
-            stops.push_back(*it);
+            bus_stops.emplace_back(bus.stops[i]->name);
         }
+
+        bus_index[std::string(bus.name)] = buses.size();
+        buses.push_back({std::string(bus.name), bus_stops, bus.is_round,
+            bus.departures});
     }
 
-    catalogue_.AddBus(request.name, stops, request.is_round);
+    // Roads whose distance is set anew, with the stops in name order as
+    // either direction may be looked up for a ride
+    std::set<std::pair<std::string, std::string>> changed_roads;
+    for (const domain::StopRequest& request : request_queue_.stops_requests)
+    {
+        const auto it = stop_index.find(request.name);
+        if (it == stop_index.end())
+        {
+            stop_index[request.name] = stops.size();
+            stops.push_back(request);
+            continue;
+        }
+
+        domain::StopRequest& stop = stops[it->second];
+        stop.lat = request.lat;
+        stop.lng = request.lng;
+        for (const auto& [stop_to, dist] : request.dists)
+        {
+            const auto dist_it = stop.dists.find(stop_to);
+            if (dist_it == stop.dists.end() || dist_it->second != dist)
+            {
+                changed_roads.insert(std::minmax(request.name, stop_to));
+            }
+            stop.dists[stop_to] = dist;
+        }
+    }
+
+    for (const domain::BusRequest& request : request_queue_.buses_requests)
+    {
+        delta.changed_buses.insert(request.name);
+
+        const auto it = bus_index.find(request.name);
+        if (it == bus_index.end())
+        {
+            bus_index[request.name] = buses.size();
+            buses.push_back(request);
+            continue;
+        }
+
+        buses[it->second] = request;
+    }
+
+    std::unordered_set<std::string> removed_stops;
+    for (const domain::RemoveRequest& request : request_queue_.remove_requests)
+    {
+        if (request.type == "Bus")
+        {
+            delta.changed_buses.insert(request.name);
+            buses.erase(std::remove_if(buses.begin(), buses.end(),
+                [&request](const domain::BusRequest& bus)
+                {
+                    return bus.name == request.name;
+                }), buses.end());
+        }
+        else if (request.type == "Stop")
+        {
+            removed_stops.insert(request.name);
+            stops.erase(std::remove_if(stops.begin(), stops.end(),
+                [&request](const domain::StopRequest& stop)
+                {
+                    return stop.name == request.name;
+                }), stops.end());
+
+            for (domain::StopRequest& stop : stops)
+            {
+                stop.dists.erase(request.name);
+            }
+        }
+    }
+
+    for (const domain::BusRequest& bus : buses)
+    {
+        for (size_t i = 0; i < bus.stops.size(); ++i)
+        {
+            if (removed_stops.count(bus.stops[i]) != 0)
+            {
+                throw std::invalid_argument("Stop " + bus.stops[i]
+                    + " can not be removed: bus " + bus.name
+                    + " still goes through it");
+            }
+
+            if (i > 0 && changed_roads.count(
+                std::minmax(bus.stops[i - 1], bus.stops[i])) != 0)
+            {
+                delta.changed_buses.insert(bus.name);
+            }
+        }
+    }
+
+    std::unordered_map<std::string_view, graph::VertexId> vertex_index;
+    for (size_t i = 0; i < stops.size(); ++i)
+    {
+        vertex_index[stops[i].name] = i;
+    }
+    for (const domain::Stop& stop : catalogue_.GetAllStops())
+    {
+        const auto it = vertex_index.find(stop.name);
+        delta.vertex_ids.push_back(it == vertex_index.end()
+            ? std::nullopt : std::optional<graph::VertexId>(it->second));
+        delta.is_vertices_kept = delta.is_vertices_kept
+            && delta.vertex_ids.back() == stop.edge_id;
+    }
+
+    request_queue_.stops_requests = std::move(stops);
+    request_queue_.buses_requests = std::move(buses);
+    request_queue_.remove_requests.clear();
+
+    return delta;
 }
 
 void JsonReader::ComputeStatRequest(json::Builder& builder,
-    const domain::StatRequest& request)
+    const domain::StatRequest& request) const
 {
     if (request.type == "Stop")
     {
         try
         {
-            std::set<std::string_view> buses_to_stop = 
+            const ranges::Span<const uint32_t> buses_to_stop =
                 catalogue_.GetBusesToStop(request.name);
+            const std::deque<domain::Bus>& buses = catalogue_.GetAllBuses();
 
             builder.StartDict().Key("buses"s).StartArray();
-            for (std::string_view bus : buses_to_stop)
+            for (const uint32_t bus : buses_to_stop)
             {
-                std::string bus_name(bus); 
-                builder.Value(bus_name);
+                builder.Value(std::string(buses[bus].name));
             }
 
             builder.EndArray().Key("request_id"s).Value(request.id).EndDict();
@@ -411,110 +933,445 @@ void JsonReader::ComputeStatRequest(json::Builder& builder,
     }
 }
 
-void JsonReader::BuildSameStopsResponse(json::Builder& builder,
-    const domain::RouteRequest& request)
+void JsonReader::BuildSameStopsResponse(json::Writer& writer,
+    const domain::RouteRequest& request) const
 {
-    builder.StartDict().Key("total_time"s).Value(0)
-        .Key("request_id"s).Value(request.id)
-        .Key("items"s).StartArray().EndArray().EndDict();
+    writer.StartDict().Key("items"sv).StartArray().EndArray()
+        .Key("request_id"sv).Value(request.id)
+        .Key("total_time"sv).Value(0).EndDict();
 }
 
-void JsonReader::BuildValidRouteResponse(
-    const graph::Router<double>::RouteInfo& route_data,
-    json::Builder& builder, const domain::RouteRequest& request)
+void JsonReader::BuildValidRouteResponse(transport_router::Weight weight,
+    const std::vector<graph::EdgeId>& edges, json::Writer& writer,
+    const domain::RouteRequest& request) const
 {
-    json::Array route_items;
+    writer.StartDict().Key("items"sv).StartArray();
 
-    for (const auto& edge_id : route_data.edges)
+    for (const auto& edge_id : edges)
     {
         const auto& edge = graph_->GetEdge(edge_id);
-        std::string stop_name = catalogue_.GetAllStops().at(edge.from).name;
 
-        json::Dict wait_type = json::Builder{}.StartDict()
-            .Key("time"s).Value(router_settings_.bus_wait_time)
-            .Key("type"s).Value("Wait"s)
-            .Key("stop_name"s).Value(stop_name).EndDict().Build().AsDict();
+        writer.StartDict()
+            .Key("stop_name"sv)
+            .Value(catalogue_.GetAllStops().at(edge.from).name)
+            .Key("time"sv).Value(router_settings_.bus_wait_time)
+            .Key("type"sv).Value("Wait"sv).EndDict();
+
+        writer.StartDict()
+            .Key("bus"sv).Value(edge.bus_name)
+            .Key("span_count"sv).Value(edge.span_count)
+            .Key("time"sv).Value(transport_router::WeightTraits::ToMinutes(
+                edge.weight) - router_settings_.bus_wait_time)
+            .Key("type"sv).Value("Bus"sv).EndDict();
+    }
+
+    writer.EndArray()
+        .Key("request_id"sv).Value(request.id)
+        .Key("total_time"sv)
+        .Value(transport_router::WeightTraits::ToMinutes(weight)).EndDict();
+}
 
-        json::Dict bus_type = json::Builder{}.StartDict()
-            .Key("time"s).Value(edge.weight - router_settings_.bus_wait_time)
-            .Key("span_count"s).Value(edge.span_count)
-            .Key("bus"s).Value(edge.bus_name)
-            .Key("type"s).Value("Bus"s)
-            .EndDict().Build().AsDict();
+void JsonReader::BuildNonValidRouteResponse(json::Writer& writer,
+    const domain::RouteRequest& request) const
+{
+    writer.StartDict().Key("error_message"sv).Value("not found"sv)
+        .Key("request_id"sv).Value(request.id)
+        .EndDict();
+}
 
-        route_items.push_back(std::move(wait_type));
-        route_items.push_back(std::move(bus_type));
+void JsonReader::BuildJourneyItems(const domain::Journey& journey,
+    json::Writer& writer) const
+{
+    writer.StartArray();
+
+    for (const domain::JourneyLeg& leg : journey.legs)
+    {
+        writer.StartDict()
+            .Key("stop_name"sv).Value(leg.stop_from->name)
+            .Key("time"sv).Value(leg.wait_time)
+            .Key("type"sv).Value("Wait"sv).EndDict();
+
+        writer.StartDict()
+            .Key("bus"sv).Value(leg.bus->name)
+            .Key("span_count"sv).Value(leg.span_count)
+            .Key("time"sv).Value(leg.ride_time)
+            .Key("type"sv).Value("Bus"sv).EndDict();
     }
 
-    builder.StartDict().Key("total_time"s).Value(route_data.weight)
-        .Key("request_id"s).Value(request.id)
-        .Key("items"s).Value(route_items).EndDict();
+    writer.EndArray();
 }
 
-void JsonReader::BuildNonValidRouteResponse(json::Builder& builder,
-    const domain::RouteRequest& request)
+void JsonReader::BuildJourneyResponse(const domain::Journey& journey,
+    json::Writer& writer, const domain::RouteRequest& request) const
 {
-    builder.StartDict().Key("request_id"s).Value(request.id)
-        .Key("error_message"s).Value("not found"s)
-        .EndDict();
+    writer.StartDict().Key("items"sv);
+    BuildJourneyItems(journey, writer);
+    writer.Key("request_id"sv).Value(request.id)
+        .Key("total_time"sv).Value(journey.total_time).EndDict();
+}
+
+void JsonReader::BuildAlternativesResponse(
+    const std::vector<domain::Journey>& journeys, json::Writer& writer,
+    const domain::RouteRequest& request) const
+{
+    writer.StartDict().Key("alternatives"sv).StartArray();
+
+    for (const domain::Journey& journey : journeys)
+    {
+        const int transfers = journey.legs.empty() ? 0
+            : static_cast<int>(journey.legs.size()) - 1;
+
+        writer.StartDict().Key("items"sv);
+        BuildJourneyItems(journey, writer);
+        writer.Key("total_time"sv).Value(journey.total_time)
+            .Key("transfers"sv).Value(transfers).EndDict();
+    }
+
+    writer.EndArray().Key("request_id"sv).Value(request.id).EndDict();
 }
 
-void JsonReader::ComputeRouteRequest(json::Builder& builder,
-    const domain::RouteRequest& request)
+void JsonReader::ComputeAlternativesRouteRequest(json::Writer& writer,
+    const domain::RouteRequest& request) const
 {
     const domain::Stop* stop_from = catalogue_.GetStop(request.from);
     const domain::Stop* stop_to = catalogue_.GetStop(request.to);
 
     if (stop_from == stop_to)
     {
-        BuildSameStopsResponse(builder, request);
+        BuildAlternativesResponse({domain::Journey{0.0, {}}}, writer,
+            request);
+
+        return;
+    }
+
+    const std::vector<domain::Journey> journeys =
+        raptor_router_->BuildAlternatives(stop_from, stop_to);
+
+    if (journeys.empty())
+    {
+        BuildNonValidRouteResponse(writer, request);
 
         return;
     }
+
+    BuildAlternativesResponse(journeys, writer, request);
+}
+
+void JsonReader::ComputeTimetableRouteRequest(json::Writer& writer,
+    const domain::RouteRequest& request) const
+{
+    const auto journey = timetable_router_->BuildRoute(
+        catalogue_.GetStop(request.from), catalogue_.GetStop(request.to),
+        *request.departure_time);
+
+    if (journey.has_value())
+    {
+        BuildJourneyResponse(journey.value(), writer, request);
+    }
     else
     {
+        BuildNonValidRouteResponse(writer, request);
+    }
+}
+
+void JsonReader::ComputeTransferRouteRequest(json::Writer& writer,
+    const domain::RouteRequest& request) const
+{
+    // Reused by all route requests computed on the thread
+    thread_local std::vector<graph::EdgeId> route_edges;
+
+    const auto weight = graph::FindRoute(*transfer_graph_,
+        catalogue_.GetStop(request.from)->edge_id,
+        catalogue_.GetStop(request.to)->edge_id, route_edges);
+
+    if (weight.has_value())
+    {
+        const transport_router::TransportRouter transport_router(
+            router_settings_);
+        BuildJourneyResponse(transport_router.MakeTransferJourney(catalogue_,
+            *transfer_graph_, weight.value(), route_edges), writer, request);
+    }
+    else
+    {
+        BuildNonValidRouteResponse(writer, request);
+    }
+}
+
+void JsonReader::ComputeRouteRequest(json::Writer& writer,
+    const domain::RouteRequest& request) const
+{
+    const trace::Span span("reader", "ComputeRouteRequest", request.id);
+    // Alternatives are built without a timetable, so a departure time
+    // could not be honored
+    if (request.alternatives && request.departure_time.has_value())
+    {
+        writer.StartDict().Key("error_message"sv)
+            .Value("alternatives can not be combined with departure_time"sv)
+            .Key("request_id"sv).Value(request.id)
+            .EndDict();
+
+        return;
+    }
+    else if (request.alternatives)
+    {
+        ComputeAlternativesRouteRequest(writer, request);
+
+        return;
+    }
+
+    const domain::Stop* stop_from = catalogue_.GetStop(request.from);
+    const domain::Stop* stop_to = catalogue_.GetStop(request.to);
+
+    if (stop_from == stop_to)
+    {
+        BuildSameStopsResponse(writer, request);
+
+        return;
+    }
+    else if (request.departure_time.has_value())
+    {
+        ComputeTimetableRouteRequest(writer, request);
+
+        return;
+    }
+    else if (transfer_graph_)
+    {
+        ComputeTransferRouteRequest(writer, request);
+
+        return;
+    }
+    else
+    {
+        // Reused by all route requests computed on the thread
+        thread_local std::vector<graph::EdgeId> route_edges;
+
         request_handler::RouterRequestHandler handler(*router_);
-        const auto route_data = handler.BuildRoute(stop_from->edge_id,
-            stop_to->edge_id);
+        const auto weight = handler.BuildRoute(stop_from->edge_id,
+            stop_to->edge_id, route_edges);
 
-        if (route_data.has_value())
+        if (weight.has_value())
         {
-            BuildValidRouteResponse(route_data.value(), builder, request);
+            BuildValidRouteResponse(weight.value(), route_edges, writer,
+                request);
 
             return;
         }
         else
         {
-            BuildNonValidRouteResponse(builder, request);
+            BuildNonValidRouteResponse(writer, request);
 
             return;
         }
     }
 }
 
-json::Node JsonReader::ComputeJSON()
+void JsonReader::ComputeIsochroneRequest(json::Builder& builder,
+    const domain::IsochroneRequest& request) const
 {
-    json::Builder result;
-    result.StartArray();
+    try
+    {
+        const domain::Stop* stop_from = catalogue_.GetStop(request.from);
+        const auto& stops = catalogue_.GetAllStops();
+
+        // Stops are the first vertices of both graphs, the transfer one
+        // has board and ride vertices after them
+        std::vector<std::pair<const domain::Stop*, double>> reachable;
+        for (const auto& [vertex, weight] : graph::ComputeReachableVertices(
+            transfer_graph_ ? *transfer_graph_ : *graph_, stop_from->edge_id,
+            transport_router::WeightTraits::FromMinutes(request.max_time)))
+        {
+            if (vertex < stops.size())
+            {
+                reachable.emplace_back(&stops[vertex],
+                    transport_router::WeightTraits::ToMinutes(weight));
+            }
+        }
 
-    if (!request_queue_.stats_requests.empty())
+        json::Array reachable_stops;
+        for (const auto& [stop, time] : reachable)
+        {
+            reachable_stops.push_back(json::Builder{}.StartDict()
+                .Key("stop_name"s).Value(std::string(stop->name))
+                .Key("time"s).Value(time).EndDict().Build());
+        }
+
+        builder.StartDict().Key("request_id"s).Value(request.id)
+            .Key("stops"s).Value(reachable_stops);
+
+        if (request.render_map)
+        {
+            const map_renderer::MapRenderer renderer(render_settings_);
+            const request_handler::MapRequestHandler handler(catalogue_,
+                renderer);
+
+            svg::Document map = handler.RenderIsochrone(reachable,
+                request.max_time);
+            std::stringstream temp;
+            map.Render(temp);
+
+            builder.Key("map"s).Value(temp.str());
+        }
+
+        builder.EndDict();
+    }
+    catch (const std::invalid_argument&)
     {
-        for (const auto& request : request_queue_.stats_requests)
+        builder.StartDict().Key("request_id"s).Value(request.id)
+            .Key("error_message"s).Value("not found"s).EndDict();
+    }
+}
+
+void JsonReader::ComputeMatrixRequest(json::Builder& builder,
+    const domain::MatrixRequest& request) const
+{
+    try
+    {
+        std::vector<graph::VertexId> targets;
+        targets.reserve(request.targets.size());
+        for (const std::string& stop : request.targets)
+        {
+            targets.push_back(catalogue_.GetStop(stop)->edge_id);
+        }
+
+        const request_handler::RouterRequestHandler handler(*router_);
+        auto& workspace =
+            graph::SearchWorkspace<transport_router::Weight>::GetForThread();
+
+        json::Array weights;
+        weights.reserve(request.sources.size());
+        for (const std::string& stop : request.sources)
         {
-            if (std::holds_alternative<domain::StatRequest>(request))
+            const graph::VertexId source = catalogue_.GetStop(stop)->edge_id;
+
+            std::vector<std::optional<transport_router::Weight>> row_weights;
+            if (transfer_graph_)
             {
-                ComputeStatRequest(result,
-                    std::get<domain::StatRequest>(request));
+                // One search from the source reaches all targets
+                graph::SearchFrom(*transfer_graph_, source,
+                    std::numeric_limits<transport_router::Weight>::max(),
+                    workspace, [](graph::VertexId, transport_router::Weight) {});
+                for (const graph::VertexId target : targets)
+                {
+                    row_weights.push_back(workspace.IsReached(target)
+                        ? std::optional(workspace.GetWeight(target))
+                        : std::nullopt);
+                }
             }
             else
             {
-                ComputeRouteRequest(result,
-                    std::get<domain::RouteRequest>(request));
+                row_weights = handler.GetRouteWeights(source, targets);
+            }
+
+            json::Array row;
+            row.reserve(targets.size());
+            for (const auto& weight : row_weights)
+            {
+                row.push_back(weight ? json::Node{
+                    transport_router::WeightTraits::ToMinutes(*weight)}
+                    : json::Node{});
             }
+
+            weights.push_back(std::move(row));
+        }
+
+        builder.StartDict().Key("request_id"s).Value(request.id)
+            .Key("weights"s).Value(std::move(weights)).EndDict();
+    }
+    catch (const std::invalid_argument&)
+    {
+        builder.StartDict().Key("request_id"s).Value(request.id)
+            .Key("error_message"s).Value("not found"s).EndDict();
+    }
+}
+
+void JsonReader::ComputeRequest(json::Writer& writer,
+    const domain::AnyStatRequest& request) const
+{
+    // Route responses are written as they are computed, the others are
+    // small enough to be built first
+    if (std::holds_alternative<domain::RouteRequest>(request))
+    {
+        ComputeRouteRequest(writer, std::get<domain::RouteRequest>(request));
+
+        return;
+    }
+
+    json::Builder builder;
+    if (std::holds_alternative<domain::StatRequest>(request))
+    {
+        ComputeStatRequest(builder, std::get<domain::StatRequest>(request));
+    }
+    else if (std::holds_alternative<domain::IsochroneRequest>(request))
+    {
+        ComputeIsochroneRequest(builder,
+            std::get<domain::IsochroneRequest>(request));
+    }
+    else
+    {
+        ComputeMatrixRequest(builder,
+            std::get<domain::MatrixRequest>(request));
+    }
+    writer.Value(builder.Build());
+}
+
+void JsonReader::ComputeTimedRequest(json::Writer& writer,
+    const domain::AnyStatRequest& request) const
+{
+    const trace::Span span("request", GetRequestType(request),
+        GetRequestId(request));
+    if (!stats_)
+    {
+        ComputeRequest(writer, request);
+
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    ComputeRequest(writer, request);
+    stats_->AddRequest(GetRequestType(request),
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+}
+
+void JsonReader::ComputeResponses(ResponseQueue& queue) const
+{
+    const trace::Span span("reader", "ComputeResponses");
+    try
+    {
+        // Each response is written into a string of the ring, so once the
+        // strings have grown no response allocates its text
+        std::string response;
+        json::StringBuffer buffer(response);
+        std::ostream stream(&buffer);
+        for (const auto& request : request_queue_.stats_requests)
+        {
+            response.clear();
+            json::Writer writer(stream, json::ArrayPrinter::ITEM_INDENT);
+            ComputeTimedRequest(writer, request);
+
+            std::unique_lock lock(queue.mutex);
+            queue.cv.wait(lock, [&queue]
+                {
+                    return queue.count < queue.responses.size();
+                });
+            response.swap(queue.responses[
+                (queue.first + queue.count) % queue.responses.size()]);
+            ++queue.count;
+            lock.unlock();
+            queue.cv.notify_all();
         }
     }
+    catch (...)
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.error = std::current_exception();
+    }
 
-    return result.EndArray().Build();
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.is_computed = true;
+    }
+    queue.cv.notify_all();
 }
 
 }
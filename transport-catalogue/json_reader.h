@@ -1,17 +1,40 @@
 #pragma once
 
+#include "bounded_search.h"
 #include "graph.h"
 #include "json_builder.h"
 #include "map_renderer.h"
+#include "raptor_router.h"
 #include "request_handler.h"
 #include "router.h"
 #include "serialization.h"
+#include "stats.h"
+#include "trace.h"
+#include "timetable_router.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
 #include <istream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 using transport_catalogue::TransportCatalogue;
 
@@ -19,8 +42,15 @@ namespace json_reader {
 
 class JsonReader {
 public:
+    // Phases of the work and stat requests are timed into stats when they
+    // are given
     explicit JsonReader(TransportCatalogue& catalogue,
-        serialization::SerializationMachine& sm, std::istream& input);
+        serialization::SerializationMachine& sm, std::istream& input,
+        stats::Stats* stats = nullptr);
+
+    JsonReader(TransportCatalogue& catalogue,
+        serialization::SerializationMachine& sm,
+        stats::Stats* stats = nullptr);
 
     void UpdateCatalogue();
 
@@ -28,30 +58,77 @@ public:
 
     void Deserialize();
 
+    void UpdateBase();
+
     void PrintStat(std::ostream& output);
 
+    // Answers stat requests of input as PrintStat does, but deserializes
+    // the base while the rest of input is parsed and prints responses
+    // while the next ones are computed
+    void ProcessRequests(std::istream& input, std::ostream& output);
+
+    // Answers a single stat request without touching the request queue,
+    // so it may be called concurrently once the base is loaded
+    void ProcessStatRequest(const json::Node& stat_request,
+        json::Writer& writer) const;
+
     const domain::RequestQueue& GetRequestQueue() const;
 
     map_renderer::RenderSettingsRequest GetRenderSettings() const;
 
+    const serialization::SerializationSettings&
+    GetSerializationSettings() const;
+
 private:
+    static constexpr size_t MAX_RESPONSES_IN_FLIGHT = 64;
+
+    // Printed texts of responses in a ring whose strings are swapped in
+    // and out rather than moved, so that they keep their capacity
+    struct ResponseQueue {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<std::string> responses =
+            std::vector<std::string>(MAX_RESPONSES_IN_FLIGHT);
+        size_t first = 0;
+        size_t count = 0;
+        bool is_computed = false;
+        std::exception_ptr error = nullptr;
+    };
+
     TransportCatalogue& catalogue_;
     domain::RequestQueue request_queue_;
     map_renderer::RenderSettingsRequest render_settings_; 
     transport_router::TransportRouterSettings router_settings_;
-    std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_ = nullptr;
-    std::unique_ptr<graph::Router<double>> router_ = nullptr;
+    std::unique_ptr<transport_router::Graph> graph_ = nullptr;
+    std::unique_ptr<transport_router::Router> router_ = nullptr;
+    // Built when loading a base made with the transfer graph model
+    std::unique_ptr<transport_router::Graph> transfer_graph_ = nullptr;
+    std::unique_ptr<timetable_router::TimetableRouter> timetable_router_ = nullptr;
+    std::unique_ptr<raptor_router::RaptorRouter> raptor_router_ = nullptr;
     serialization::SerializationMachine serialization_machine_;
+    stats::Stats* stats_;
 
     void ParseStopRequest(const json::Node& stop_request);
 
+    std::vector<double> ParseTimetable(const json::Node& timetable);
+
     void ParseBusRequest(const json::Node& bus_request);
 
+    void ParseRemoveRequest(const json::Node& remove_request);
+
     void ParseBaseRequests(const json::Node& base_requests);
 
-    void ParseRouteRequest(const json::Dict& route_request);
+    domain::RouteRequest ParseRouteRequest(
+        const json::Dict& route_request) const;
+
+    domain::IsochroneRequest ParseIsochroneRequest(
+        const json::Dict& isochrone_request) const;
 
-    void ParseStatRequest(const json::Node& stat_request);
+    domain::MatrixRequest ParseMatrixRequest(
+        const json::Dict& matrix_request) const;
+
+    domain::AnyStatRequest ParseStatRequest(
+        const json::Node& stat_request) const;
 
     void ParseStatRequests(const json::Node& stat_requests);
 
@@ -71,23 +148,70 @@ private:
 
     void ProcessingBusRequest(const domain::BusRequest& request);
 
+    // What update_base changes for the routing data
+    struct BaseDelta {
+        // Buses added, modified, removed or riding a road whose distance
+        // changed
+        std::unordered_set<std::string> changed_buses;
+        // New vertex of every stop of the loaded base, nothing if removed
+        std::vector<std::optional<graph::VertexId>> vertex_ids;
+        bool is_vertices_kept = true;
+    };
+
+    // Puts the loaded catalogue merged with the delta into the request
+    // queue. Throws if a removed stop is still on a bus
+    BaseDelta MergeBaseRequests();
+
     void ComputeStatRequest(json::Builder& builder,
-        const domain::StatRequest& request);
+        const domain::StatRequest& request) const;
+
+    void BuildSameStopsResponse(json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    void BuildValidRouteResponse(transport_router::Weight weight,
+        const std::vector<graph::EdgeId>& edges, json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    void BuildNonValidRouteResponse(json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    void BuildJourneyItems(const domain::Journey& journey,
+        json::Writer& writer) const;
+
+    void BuildJourneyResponse(const domain::Journey& journey,
+        json::Writer& writer, const domain::RouteRequest& request) const;
+
+    void BuildAlternativesResponse(
+        const std::vector<domain::Journey>& journeys,
+        json::Writer& writer, const domain::RouteRequest& request) const;
+
+    void ComputeAlternativesRouteRequest(json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    void ComputeTimetableRouteRequest(json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    // Searches the transfer graph, printing the legs the classic graph
+    // would be printed with
+    void ComputeTransferRouteRequest(json::Writer& writer,
+        const domain::RouteRequest& request) const;
+
+    void ComputeRouteRequest(json::Writer& writer,
+        const domain::RouteRequest& request) const;
 
-    void BuildSameStopsResponse(json::Builder& builder,
-        const domain::RouteRequest& request);
+    void ComputeIsochroneRequest(json::Builder& builder,
+        const domain::IsochroneRequest& request) const;
 
-    void BuildValidRouteResponse(
-        const graph::Router<double>::RouteInfo& route_data,
-        json::Builder& builder, const domain::RouteRequest& request);
+    void ComputeMatrixRequest(json::Builder& builder,
+        const domain::MatrixRequest& request) const;
 
-    void BuildNonValidRouteResponse(json::Builder& builder,
-        const domain::RouteRequest& request);
+    void ComputeRequest(json::Writer& writer,
+        const domain::AnyStatRequest& request) const;
 
-    void ComputeRouteRequest(json::Builder& builder,
-        const domain::RouteRequest& request);
+    void ComputeTimedRequest(json::Writer& writer,
+        const domain::AnyStatRequest& request) const;
 
-    json::Node ComputeJSON();
+    void ComputeResponses(ResponseQueue& queue) const;
 };
 
 }
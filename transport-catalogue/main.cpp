@@ -1,39 +1,137 @@
 #include "json_reader.h"
+#include "query_server.h"
 #include "serialization.h"
+#include "stats.h"
+#include "trace.h"
 #include "transport_catalogue.h"
 
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 using namespace std::literals;
 
+namespace {
+
+const std::string_view STATS_OPTION = "--stats"sv;
+const std::string_view TRACE_OPTION = "--trace="sv;
+
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests]"sv
+              " [--stats[=file]] [--trace=file]\n"sv
+           << "       transport_catalogue serve [socket_path] [--stats[=file]]"sv
+              " [--trace=file]\n"sv
+           << "--stats writes timing of phases, latencies of requests and peak\n"sv
+              "memory usage as JSON to stderr or to the file\n"sv
+           << "--trace writes spans of requests, routing, rendering and\n"sv
+              "serialization as a Chrome trace_event file for Perfetto\n"sv;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        PrintUsage();
-        return 1;
+// Returns false for an unknown mode, so that usage is printed
+bool RunMode(std::string_view mode, const std::vector<std::string_view>& args,
+    stats::Stats* stats) {
+    transport_catalogue::TransportCatalogue catalogue;
+    serialization::SerializationMachine sm(catalogue);
+
+    if (mode == "process_requests"sv) {
+        json_reader::JsonReader json_reader(catalogue, sm, stats);
+        json_reader.ProcessRequests(std::cin, std::cout);
+        return true;
     }
 
-    const std::string_view mode(argv[1]);
+    json_reader::JsonReader json_reader(catalogue, sm, std::cin, stats);
 
-    transport_catalogue::TransportCatalogue catalogue;
-    serialization::SerializationMachine sm(catalogue);
-    json_reader::JsonReader json_reader(catalogue, sm, std::cin);
-        
     if (mode == "make_base"sv) {
         json_reader.UpdateCatalogue();
         json_reader.Serialize();
 
-    } else if (mode == "process_requests"sv) {
+    } else if (mode == "update_base"sv) {
         json_reader.Deserialize();
-        json_reader.PrintStat(std::cout);
+        json_reader.UpdateBase();
+
+    } else if (mode == "serve"sv) {
+        query_server::QueryServer server(json_reader.GetSerializationSettings(),
+            std::thread::hardware_concurrency(), stats);
+        if (args.size() == 1) {
+            server.ServeSocket(std::string(args.front()));
+        } else {
+            server.Serve(std::cin, std::cout);
+        }
+        server.PrintLatencyReport(std::cerr);
 
     } else {
+        return false;
+    }
+
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string_view> args;
+    std::optional<std::string> stats_file;
+    std::optional<std::string> trace_file;
+    bool is_stats = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg(argv[i]);
+        if (arg == STATS_OPTION) {
+            is_stats = true;
+        } else if (arg.substr(0, STATS_OPTION.size() + 1) == "--stats="sv) {
+            is_stats = true;
+            stats_file = std::string(arg.substr(STATS_OPTION.size() + 1));
+        } else if (arg.substr(0, TRACE_OPTION.size()) == TRACE_OPTION) {
+            trace_file = std::string(arg.substr(TRACE_OPTION.size()));
+        } else {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string_view mode = args.front();
+    args.erase(args.begin());
+    if (!args.empty() && !(args.size() == 1 && mode == "serve"sv)) {
         PrintUsage();
         return 1;
     }
+
+    if (trace_file) {
+        trace::Tracer::GetInstance().Start();
+    }
+
+    stats::Stats stats;
+    bool is_known_mode = false;
+    {
+        const stats::ScopedTimer timer(is_stats ? &stats : nullptr, "total"s);
+        is_known_mode = RunMode(mode, args, is_stats ? &stats : nullptr);
+    }
+
+    if (trace_file) {
+        std::ofstream output(*trace_file);
+        trace::Tracer::GetInstance().Finish(output);
+    }
+
+    if (!is_known_mode) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (is_stats) {
+        const json::Document report{stats.BuildReport()};
+        if (stats_file) {
+            std::ofstream output(*stats_file);
+            json::Print(report, output);
+        } else {
+            json::Print(report, std::cerr);
+            std::cerr << std::endl;
+        }
+    }
 }
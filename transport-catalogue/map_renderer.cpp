@@ -9,6 +9,69 @@ bool IsZero(double value)
     return std::abs(value) < EPSILON;
 }
 
+std::optional<GeoBounds> ComputeBounds(const std::vector<double>& lats,
+    const std::vector<double>& lngs)
+{
+    if (lats.empty())
+    {
+        return std::nullopt;
+    }
+
+    GeoBounds bounds{lats[0], lats[0], lngs[0], lngs[0]};
+    for (size_t i = 1; i < lats.size(); ++i)
+    {
+        bounds.min_lat = std::min(bounds.min_lat, lats[i]);
+        bounds.max_lat = std::max(bounds.max_lat, lats[i]);
+    }
+    for (size_t i = 1; i < lngs.size(); ++i)
+    {
+        bounds.min_lng = std::min(bounds.min_lng, lngs[i]);
+        bounds.max_lng = std::max(bounds.max_lng, lngs[i]);
+    }
+
+    return bounds;
+}
+
+SphereProjector::SphereProjector(const std::optional<GeoBounds>& bounds,
+    double max_width, double max_height, double padding)
+    : padding_(padding)
+{
+    if (!bounds)
+    {
+        return;
+    }
+
+    min_lon_ = bounds->min_lng;
+    max_lat_ = bounds->max_lat;
+
+    std::optional<double> width_zoom;
+    if (!IsZero(bounds->max_lng - bounds->min_lng))
+    {
+        width_zoom = (max_width - 2 * padding) /
+            (bounds->max_lng - bounds->min_lng);
+    }
+
+    std::optional<double> height_zoom;
+    if (!IsZero(bounds->max_lat - bounds->min_lat))
+    {
+        height_zoom = (max_height - 2 * padding) /
+            (bounds->max_lat - bounds->min_lat);
+    }
+
+    if (width_zoom && height_zoom)
+    {
+        zoom_coeff_ = std::min(*width_zoom, *height_zoom);
+    }
+    else if (width_zoom)
+    {
+        zoom_coeff_ = *width_zoom;
+    }
+    else if (height_zoom)
+    {
+        zoom_coeff_ = *height_zoom;
+    }
+}
+
 svg::Point SphereProjector::operator()(geo::Coordinates coords) const
 {
     return {(coords.lng - min_lon_) * zoom_coeff_ + padding_,
@@ -41,81 +104,146 @@ MapRenderer::MapRenderer(RenderSettingsRequest render_settings)
 {
 }
 
-svg::Document MapRenderer::RenderMap(
-    const std::map<std::string, domain::Bus*>& routes) const
+svg::Document MapRenderer::RenderMap(const std::deque<domain::Bus>& buses,
+    const std::vector<uint32_t>& route_ids,
+    const domain::StopTable& stop_table) const
 {
-    svg::Document doc;
+    const trace::Span span("render", "MapRenderer::RenderMap");
 
-    const double WIDTH = render_settings_.width;
-    const double HEIGHT = render_settings_.height;
-    const double PADDING = render_settings_.padding;
+    const std::vector<uint16_t> stop_ids = CollectStops(buses, route_ids,
+        stop_table);
+
+    return RenderMap(buses, route_ids, stop_ids,
+        MakeProjector(stop_ids, stop_table), stop_table);
+}
+
+svg::Document MapRenderer::RenderIsochrone(
+    const std::deque<domain::Bus>& buses,
+    const std::vector<uint32_t>& route_ids,
+    const domain::StopTable& stop_table,
+    const std::vector<std::pair<const domain::Stop*, double>>& reachable,
+    double max_time) const
+{
+    const trace::Span span("render", "MapRenderer::RenderIsochrone");
 
-    std::vector<geo::Coordinates> geo_coords;
-    for (const auto& [name, route] : routes)
+    const std::vector<uint16_t> stop_ids = CollectStops(buses, route_ids,
+        stop_table);
+    const details::SphereProjector proj = MakeProjector(stop_ids, stop_table);
+    svg::Document doc = RenderMap(buses, route_ids, stop_ids, proj,
+        stop_table);
+
+    const auto& palette = render_settings_.color_palette;
+    if (palette.empty())
     {
-        for (auto it = route->stops.begin(); it != route->stops.end(); ++it)
-        {
-            geo_coords.push_back((*it)->coords);
-        }
+        return doc;
     }
 
-    const details::SphereProjector proj{geo_coords.begin(), geo_coords.end(),
-        WIDTH, HEIGHT, PADDING};
+    for (const auto& [stop, time] : reachable)
+    {
+        size_t band = max_time > 0.0
+            ? static_cast<size_t>(time / max_time * palette.size()) : 0;
+        band = std::min(band, palette.size() - 1);
+
+        svg::Circle crcl;
+        crcl.SetCenter(proj(stop->coords))
+            .SetRadius(render_settings_.stop_radius * 2)
+            .SetFillColor(palette.at(band))
+            .SetStrokeColor(render_settings_.underlayer_color)
+            .SetStrokeWidth(render_settings_.underlayer_width);
+
+        doc.Add(crcl);
+    }
+
+    return doc;
+}
+
+svg::Document MapRenderer::RenderMap(const std::deque<domain::Bus>& buses,
+    const std::vector<uint32_t>& route_ids,
+    const std::vector<uint16_t>& stop_ids,
+    const details::SphereProjector& proj,
+    const domain::StopTable& stop_table) const
+{
+    svg::Document doc;
 
     details::ColorPalettePicker color_picker1(render_settings_.color_palette);
-    for (const auto& route : routes)
+    for (const uint32_t id : route_ids)
     {
-        if (!(route.second->stops.empty()))
+        if (!(buses[id].stops.empty()))
         {
             const svg::Color route_color = color_picker1.GetColor();
-            RenderRoute(route.second, proj, route_color, doc);
+            RenderRoute(&buses[id], proj, route_color, stop_table, doc);
         }
     }
 
     details::ColorPalettePicker color_picker2(render_settings_.color_palette);
-    for (const auto& route : routes)
+    for (const uint32_t id : route_ids)
     {
-        if (!(route.second->stops.empty()))
+        if (!(buses[id].stops.empty()))
         {
             const svg::Color route_color = color_picker2.GetColor();
-            RenderRouteName(route.second, proj, route_color, doc);
+            RenderRouteName(&buses[id], proj, route_color, doc);
         }
     }
 
-    std::vector<domain::Stop*> stops;
-    for (const auto& route : routes)
+    RenderStopsPoints(stop_ids, proj, stop_table, doc);
+
+    RenderStopsNames(stop_ids, proj, stop_table, doc);
+
+    return doc;
+}
+
+std::vector<uint16_t> MapRenderer::CollectStops(
+    const std::deque<domain::Bus>& buses,
+    const std::vector<uint32_t>& route_ids,
+    const domain::StopTable& stop_table) const
+{
+    std::vector<bool> is_used(stop_table.lat.size(), false);
+    std::vector<uint16_t> stop_ids;
+    for (const uint32_t id : route_ids)
     {
-        for (const auto& stop : route.second->stops)
+        for (const domain::Stop* stop : buses[id].stops)
         {
-            stops.push_back(stop);
+            if (!is_used[stop->edge_id])
+            {
+                is_used[stop->edge_id] = true;
+                stop_ids.push_back(stop->edge_id);
+            }
         }
     }
 
-    std::sort(stops.begin(), stops.end(),
-        [](domain::Stop* lhs, domain::Stop* rhs)
+    std::sort(stop_ids.begin(), stop_ids.end(),
+        [&stop_table](uint16_t lhs, uint16_t rhs)
         {
-            return lhs->name < rhs->name;
+            return stop_table.GetName(lhs) < stop_table.GetName(rhs);
         });
-    auto last = std::unique(stops.begin(), stops.end());
-    stops.erase(last, stops.end());
 
-    RenderStopsPoints(stops, proj, doc);
+    return stop_ids;
+}
 
-    RenderStopsNames(stops, proj, doc);
+details::SphereProjector MapRenderer::MakeProjector(
+    const std::vector<uint16_t>& stop_ids,
+    const domain::StopTable& stop_table) const
+{
+    const double WIDTH = render_settings_.width;
+    const double HEIGHT = render_settings_.height;
+    const double PADDING = render_settings_.padding;
 
-    return doc;
+    std::vector<double> lats(stop_ids.size());
+    std::vector<double> lngs(stop_ids.size());
+    for (size_t i = 0; i < stop_ids.size(); ++i)
+    {
+        lats[i] = stop_table.lat[stop_ids[i]];
+        lngs[i] = stop_table.lng[stop_ids[i]];
+    }
+
+    return details::SphereProjector{details::ComputeBounds(lats, lngs),
+        WIDTH, HEIGHT, PADDING};
 }
 
 void MapRenderer::RenderRoute(const domain::Bus* route,
     const details::SphereProjector& proj, const svg::Color& color,
-    svg::Document& doc) const
+    const domain::StopTable& stop_table, svg::Document& doc) const
 {
-    std::vector<geo::Coordinates> geo_coords;
-    for (auto it = route->stops.begin(); it != route->stops.end(); ++it)
-    {
-        geo_coords.push_back((*it)->coords);
-    }
-
     svg::Polyline route_line;
     route_line.SetFillColor("none")
               .SetStrokeColor(color)
@@ -123,9 +251,10 @@ void MapRenderer::RenderRoute(const domain::Bus* route,
               .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
               .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
 
-    for (const auto geo_coord : geo_coords)
+    for (const domain::Stop* stop : route->stops)
     {
-        const svg::Point screen_coord = proj(geo_coord);
+        const svg::Point screen_coord = proj({stop_table.lat[stop->edge_id],
+            stop_table.lng[stop->edge_id]});
         route_line.AddPoint(screen_coord);
     }
 
@@ -144,7 +273,7 @@ void MapRenderer::RenderRouteName(const domain::Bus* route,
                   .SetFontSize(render_settings_.bus_label_font_size)
                   .SetFontFamily("Verdana")
                   .SetFontWeight("bold")
-                  .SetData(route->name)
+                  .SetData(std::string(route->name))
                   .SetFillColor(render_settings_.underlayer_color)
                   .SetStrokeColor(render_settings_.underlayer_color)
                   .SetStrokeWidth(render_settings_.underlayer_width)
@@ -157,7 +286,7 @@ void MapRenderer::RenderRouteName(const domain::Bus* route,
                   .SetFontSize(render_settings_.bus_label_font_size)
                   .SetFontFamily("Verdana")
                   .SetFontWeight("bold")
-                  .SetData(route->name)
+                  .SetData(std::string(route->name))
                   .SetFillColor(color);
 
     const svg::Point screen_coords = proj(route->stops.at(0)->coords);
@@ -176,12 +305,14 @@ void MapRenderer::RenderRouteName(const domain::Bus* route,
     }
 }
 
-void MapRenderer::RenderStopsPoints(const std::vector<domain::Stop*> stops,
-    const details::SphereProjector& proj, svg::Document& doc) const
+void MapRenderer::RenderStopsPoints(const std::vector<uint16_t>& stop_ids,
+    const details::SphereProjector& proj,
+    const domain::StopTable& stop_table, svg::Document& doc) const
 {
-    for (const domain::Stop* stop : stops)
+    for (const uint16_t id : stop_ids)
     {
-        const svg::Point screen_coords = proj(stop->coords);
+        const svg::Point screen_coords = proj({stop_table.lat[id],
+            stop_table.lng[id]});
         svg::Circle crcl;
         crcl.SetCenter(screen_coords)
             .SetRadius(render_settings_.stop_radius)
@@ -191,17 +322,20 @@ void MapRenderer::RenderStopsPoints(const std::vector<domain::Stop*> stops,
     }
 }
 
-void MapRenderer::RenderStopsNames(const std::vector<domain::Stop*> stops,
-    const details::SphereProjector& proj, svg::Document& doc) const
+void MapRenderer::RenderStopsNames(const std::vector<uint16_t>& stop_ids,
+    const details::SphereProjector& proj,
+    const domain::StopTable& stop_table, svg::Document& doc) const
 {
-    for (const domain::Stop* stop : stops)
+    for (const uint16_t id : stop_ids)
     {
+        const std::string name(stop_table.GetName(id));
+
         svg::Text route_name_pad;
         route_name_pad.SetOffset({render_settings_.stop_label_offset.first,
             render_settings_.stop_label_offset.second})
                     .SetFontSize(render_settings_.stop_label_font_size)
                     .SetFontFamily("Verdana")
-                    .SetData(stop->name)
+                    .SetData(name)
                     .SetFillColor(render_settings_.underlayer_color)
                     .SetStrokeColor(render_settings_.underlayer_color)
                     .SetStrokeWidth(render_settings_.underlayer_width)
@@ -213,10 +347,11 @@ void MapRenderer::RenderStopsNames(const std::vector<domain::Stop*> stops,
             render_settings_.stop_label_offset.second})
                     .SetFontSize(render_settings_.stop_label_font_size)
                     .SetFontFamily("Verdana")
-                    .SetData(stop->name)
+                    .SetData(name)
                     .SetFillColor("black");
 
-        const svg::Point screen_coords = proj(stop->coords);
+        const svg::Point screen_coords = proj({stop_table.lat[id],
+            stop_table.lng[id]});
         doc.Add(route_name_pad.SetPosition(screen_coords));
         doc.Add(route_name.SetPosition(screen_coords));
     }
@@ -2,11 +2,15 @@
 
 #include "domain.h"
 #include "svg.h"
+#include "trace.h"
 
 #include <algorithm>
 #include <cstdlib>
+#include <deque>
 #include <optional>
 #include <set>
+#include <utility>
+#include <vector>
 
 namespace map_renderer {
 
@@ -30,12 +34,27 @@ namespace details {
 inline const double EPSILON = 1e-6;
 bool IsZero(double value);
 
+struct GeoBounds {
+    double min_lat = 0.0;
+    double max_lat = 0.0;
+    double min_lng = 0.0;
+    double max_lng = 0.0;
+};
+
+// Bounds of the points given as columns of equal size, or nothing for no
+// points; each column is scanned in a separate loop over contiguous memory
+std::optional<GeoBounds> ComputeBounds(const std::vector<double>& lats,
+    const std::vector<double>& lngs);
+
 class SphereProjector {
 public:
     template <typename PointInputIt>
     SphereProjector(PointInputIt points_begin, PointInputIt points_end,
         double max_width, double max_height, double padding);
 
+    SphereProjector(const std::optional<GeoBounds>& bounds, double max_width,
+        double max_height, double padding);
+
     svg::Point operator()(geo::Coordinates coords) const;
 
 private:
@@ -49,49 +68,20 @@ template <typename PointInputIt>
 SphereProjector::SphereProjector(PointInputIt points_begin,
     PointInputIt points_end, double max_width, double max_height,
     double padding)
-    : padding_(padding)
+    : SphereProjector(
+        [points_begin, points_end]() -> std::optional<GeoBounds>
+        {
+            std::vector<double> lats;
+            std::vector<double> lngs;
+            for (auto it = points_begin; it != points_end; ++it)
+            {
+                lats.push_back(it->lat);
+                lngs.push_back(it->lng);
+            }
+
+            return ComputeBounds(lats, lngs);
+        }(), max_width, max_height, padding)
 {
-    if (points_begin == points_end)
-    {
-        return;
-    }
-
-    const auto [left_it, right_it] = std::minmax_element(
-        points_begin, points_end,
-        [](auto lhs, auto rhs) { return lhs.lng < rhs.lng; });
-    min_lon_ = left_it->lng;
-    const double max_lon = right_it->lng;
-
-    const auto [bottom_it, top_it] = std::minmax_element(
-        points_begin, points_end,
-        [](auto lhs, auto rhs) { return lhs.lat < rhs.lat; });
-    const double min_lat = bottom_it->lat;
-    max_lat_ = top_it->lat;
-
-    std::optional<double> width_zoom;
-    if (!IsZero(max_lon - min_lon_))
-    {
-        width_zoom = (max_width - 2 * padding) / (max_lon - min_lon_);
-    }
-
-    std::optional<double> height_zoom;
-    if (!IsZero(max_lat_ - min_lat))
-    {
-        height_zoom = (max_height - 2 * padding) / (max_lat_ - min_lat);
-    }
-
-    if (width_zoom && height_zoom)
-    {
-        zoom_coeff_ = std::min(*width_zoom, *height_zoom);
-    }
-    else if (width_zoom)
-    {
-        zoom_coeff_ = *width_zoom;
-    }
-    else if (height_zoom)
-    {
-        zoom_coeff_ = *height_zoom;
-    }
 }
 
 class ColorPalettePicker {
@@ -112,25 +102,56 @@ class MapRenderer {
 public:
     MapRenderer(RenderSettingsRequest render_settings);
 
-    svg::Document RenderMap(
-        const std::map<std::string, domain::Bus*>& routes) const;
+    // Renders buses[id] for every id of route_ids in that order. Coordinates
+    // and names of stops are read from the stop table of the catalogue that
+    // owns the buses
+    svg::Document RenderMap(const std::deque<domain::Bus>& buses,
+        const std::vector<uint32_t>& route_ids,
+        const domain::StopTable& stop_table) const;
+
+    // Renders the map with stops reachable within max_time highlighted,
+    // colored by palette from the nearest to the farthest time band
+    svg::Document RenderIsochrone(const std::deque<domain::Bus>& buses,
+        const std::vector<uint32_t>& route_ids,
+        const domain::StopTable& stop_table,
+        const std::vector<std::pair<const domain::Stop*, double>>& reachable,
+        double max_time) const;
 
 private:
     RenderSettingsRequest render_settings_;
 
+    // Renders the map of the routes with stop ids and the projector that
+    // CollectStops and MakeProjector give for them
+    svg::Document RenderMap(const std::deque<domain::Bus>& buses,
+        const std::vector<uint32_t>& route_ids,
+        const std::vector<uint16_t>& stop_ids,
+        const details::SphereProjector& proj,
+        const domain::StopTable& stop_table) const;
+
+    // Ids of the stops on the routes, unique and sorted by name
+    std::vector<uint16_t> CollectStops(const std::deque<domain::Bus>& buses,
+        const std::vector<uint32_t>& route_ids,
+        const domain::StopTable& stop_table) const;
+
+    details::SphereProjector MakeProjector(
+        const std::vector<uint16_t>& stop_ids,
+        const domain::StopTable& stop_table) const;
+
     void RenderRoute(const domain::Bus* route,
         const details::SphereProjector& proj, const svg::Color& color,
-        svg::Document& doc) const;
+        const domain::StopTable& stop_table, svg::Document& doc) const;
     
     void RenderRouteName(const domain::Bus* route,
         const details::SphereProjector& proj, const svg::Color& color,
         svg::Document& doc) const;
 
-    void RenderStopsPoints(const std::vector<domain::Stop*> stops,
-        const details::SphereProjector& proj, svg::Document& doc) const;
+    void RenderStopsPoints(const std::vector<uint16_t>& stop_ids,
+        const details::SphereProjector& proj,
+        const domain::StopTable& stop_table, svg::Document& doc) const;
 
-    void RenderStopsNames(const std::vector<domain::Stop*> stops,
-        const details::SphereProjector& proj, svg::Document& doc) const;
+    void RenderStopsNames(const std::vector<uint16_t>& stop_ids,
+        const details::SphereProjector& proj,
+        const domain::StopTable& stop_table, svg::Document& doc) const;
 };
 
 }
@@ -0,0 +1,238 @@
+#include "min_plus.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MIN_PLUS_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std::literals;
+
+namespace min_plus {
+
+namespace {
+
+template <typename Weight>
+using RowKernel = void (*)(Weight, const Weight*, const uint32_t*, Weight*,
+    uint32_t*, size_t);
+
+enum class InstructionSet {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+InstructionSet DetectInstructionSet()
+{
+#ifdef MIN_PLUS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return InstructionSet::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return InstructionSet::AVX2;
+    }
+#endif
+
+    return InstructionSet::SCALAR;
+}
+
+InstructionSet GetInstructionSet()
+{
+    static const InstructionSet instruction_set = DetectInstructionSet();
+
+    return instruction_set;
+}
+
+#ifdef MIN_PLUS_X86
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(double through, const double* through_row,
+    const uint32_t* through_prev_edges, double* row, uint32_t* prev_edges,
+    size_t count)
+{
+    const __m256d through_vector = _mm256_set1_pd(through);
+
+    size_t j = 0;
+    for (; j + 4 <= count; j += 4)
+    {
+        const __m256d candidate = _mm256_add_pd(through_vector,
+            _mm256_loadu_pd(through_row + j));
+        const __m256d current = _mm256_loadu_pd(row + j);
+        const __m256d is_less = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+
+        // Routes get shorter rarely once the table fills up, so the edges
+        // are copied lane by lane
+        int mask = _mm256_movemask_pd(is_less);
+        if (mask == 0)
+        {
+            continue;
+        }
+
+        _mm256_storeu_pd(row + j, _mm256_blendv_pd(current, candidate,
+            is_less));
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const size_t lane = j + __builtin_ctz(mask);
+            prev_edges[lane] = through_prev_edges[lane];
+        }
+    }
+
+    RelaxRow<double>(through, through_row + j, through_prev_edges + j,
+        row + j, prev_edges + j, count - j);
+}
+
+__attribute__((target("avx2")))
+void RelaxRowAvx2(uint32_t through, const uint32_t* through_row,
+    const uint32_t* through_prev_edges, uint32_t* row, uint32_t* prev_edges,
+    size_t count)
+{
+    const __m256i through_vector = _mm256_set1_epi32(
+        static_cast<int>(through));
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8)
+    {
+        const __m256i candidate = _mm256_add_epi32(through_vector,
+            _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(through_row + j)));
+        const __m256i current = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(row + j));
+
+        // There is no unsigned comparison in AVX2: lanes whose minimum
+        // differs from the current weight are the ones that decrease
+        const __m256i minimum = _mm256_min_epu32(candidate, current);
+        const __m256i is_less = _mm256_xor_si256(
+            _mm256_cmpeq_epi32(minimum, current), _mm256_set1_epi32(-1));
+        if (_mm256_testz_si256(is_less, is_less))
+        {
+            continue;
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + j), minimum);
+
+        const __m256i current_edges = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(prev_edges + j));
+        const __m256i through_edges = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(through_prev_edges + j));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(prev_edges + j),
+            _mm256_blendv_epi8(current_edges, through_edges, is_less));
+    }
+
+    RelaxRow<uint32_t>(through, through_row + j, through_prev_edges + j,
+        row + j, prev_edges + j, count - j);
+}
+
+__attribute__((target("avx512f")))
+void RelaxRowAvx512(double through, const double* through_row,
+    const uint32_t* through_prev_edges, double* row, uint32_t* prev_edges,
+    size_t count)
+{
+    const __m512d through_vector = _mm512_set1_pd(through);
+
+    size_t j = 0;
+    for (; j + 8 <= count; j += 8)
+    {
+        const __m512d candidate = _mm512_add_pd(through_vector,
+            _mm512_loadu_pd(through_row + j));
+        const __mmask8 is_less = _mm512_cmp_pd_mask(candidate,
+            _mm512_loadu_pd(row + j), _CMP_LT_OQ);
+        if (is_less == 0)
+        {
+            continue;
+        }
+
+        _mm512_mask_storeu_pd(row + j, is_less, candidate);
+        for (unsigned mask = is_less; mask != 0; mask &= mask - 1)
+        {
+            const size_t lane = j + __builtin_ctz(mask);
+            prev_edges[lane] = through_prev_edges[lane];
+        }
+    }
+
+    RelaxRow<double>(through, through_row + j, through_prev_edges + j,
+        row + j, prev_edges + j, count - j);
+}
+
+__attribute__((target("avx512f")))
+void RelaxRowAvx512(uint32_t through, const uint32_t* through_row,
+    const uint32_t* through_prev_edges, uint32_t* row, uint32_t* prev_edges,
+    size_t count)
+{
+    const __m512i through_vector = _mm512_set1_epi32(
+        static_cast<int>(through));
+
+    size_t j = 0;
+    for (; j + 16 <= count; j += 16)
+    {
+        const __m512i candidate = _mm512_add_epi32(through_vector,
+            _mm512_loadu_si512(through_row + j));
+        const __mmask16 is_less = _mm512_cmplt_epu32_mask(candidate,
+            _mm512_loadu_si512(row + j));
+        if (is_less == 0)
+        {
+            continue;
+        }
+
+        _mm512_mask_storeu_epi32(row + j, is_less, candidate);
+        _mm512_mask_storeu_epi32(prev_edges + j, is_less,
+            _mm512_loadu_si512(through_prev_edges + j));
+    }
+
+    RelaxRow<uint32_t>(through, through_row + j, through_prev_edges + j,
+        row + j, prev_edges + j, count - j);
+}
+
+#endif
+
+template <typename Weight>
+RowKernel<Weight> PickKernel()
+{
+    switch (GetInstructionSet())
+    {
+#ifdef MIN_PLUS_X86
+        case InstructionSet::AVX512:
+            return &RelaxRowAvx512;
+        case InstructionSet::AVX2:
+            return &RelaxRowAvx2;
+#endif
+        default:
+            return &RelaxRow<Weight>;
+    }
+}
+
+}
+
+void RelaxRow(double through, const double* through_row,
+    const uint32_t* through_prev_edges, double* row, uint32_t* prev_edges,
+    size_t count)
+{
+    static const RowKernel<double> kernel = PickKernel<double>();
+
+    kernel(through, through_row, through_prev_edges, row, prev_edges, count);
+}
+
+void RelaxRow(uint32_t through, const uint32_t* through_row,
+    const uint32_t* through_prev_edges, uint32_t* row, uint32_t* prev_edges,
+    size_t count)
+{
+    static const RowKernel<uint32_t> kernel = PickKernel<uint32_t>();
+
+    kernel(through, through_row, through_prev_edges, row, prev_edges, count);
+}
+
+std::string_view GetKernelName()
+{
+    switch (GetInstructionSet())
+    {
+        case InstructionSet::AVX512:
+            return "avx512"sv;
+        case InstructionSet::AVX2:
+            return "avx2"sv;
+        default:
+            return "scalar"sv;
+    }
+}
+
+}  // namespace min_plus
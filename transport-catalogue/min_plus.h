@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace min_plus {
+
+// Min-plus update of a row of the all-pairs table through a vertex:
+// row[j] = min(row[j], through + through_row[j]), and prev_edges[j] is set
+// to through_prev_edges[j] wherever row[j] decreases. Missing routes are
+// held as weights no sum of two real weights can reach, so no branches are
+// needed on them
+template <typename Weight>
+void RelaxRow(Weight through, const Weight* through_row,
+    const uint32_t* through_prev_edges, Weight* row, uint32_t* prev_edges,
+    size_t count)
+{
+    for (size_t j = 0; j < count; ++j)
+    {
+        const Weight candidate = through + through_row[j];
+        if (candidate < row[j])
+        {
+            row[j] = candidate;
+            prev_edges[j] = through_prev_edges[j];
+        }
+    }
+}
+
+// Same for the weight types the router is built with, using AVX-512 or
+// AVX2 when the CPU has them
+void RelaxRow(double through, const double* through_row,
+    const uint32_t* through_prev_edges, double* row, uint32_t* prev_edges,
+    size_t count);
+
+void RelaxRow(uint32_t through, const uint32_t* through_row,
+    const uint32_t* through_prev_edges, uint32_t* row, uint32_t* prev_edges,
+    size_t count);
+
+// Instruction set picked for this CPU: "avx512", "avx2" or "scalar"
+std::string_view GetKernelName();
+
+}  // namespace min_plus
@@ -0,0 +1,496 @@
+#include "query_server.h"
+
+#include <chrono>
+#include <csignal>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std::literals;
+
+namespace query_server {
+
+namespace {
+
+serialization::SerializationMachine MakeSerializationMachine(
+    transport_catalogue::TransportCatalogue& catalogue,
+    const serialization::SerializationSettings& settings)
+{
+    serialization::SerializationMachine serialization_machine(catalogue);
+    serialization_machine.SetSettings(settings);
+
+    return serialization_machine;
+}
+
+std::filesystem::file_time_type GetFileTime(const std::string& file_name)
+{
+    std::error_code error;
+    const auto file_time = std::filesystem::last_write_time(file_name, error);
+
+    return error ? std::filesystem::file_time_type{} : file_time;
+}
+
+volatile std::sig_atomic_t is_stop_requested = 0;
+
+extern "C" void RequestStop(int)
+{
+    is_stop_requested = 1;
+}
+
+}
+
+BaseSnapshot::BaseSnapshot(
+    const serialization::SerializationSettings& settings, stats::Stats* stats)
+    : serialization_machine_(MakeSerializationMachine(catalogue_, settings))
+    , json_reader_(catalogue_, serialization_machine_, stats)
+{
+    json_reader_.Deserialize();
+}
+
+void BaseSnapshot::ProcessStatRequest(const json::Node& stat_request,
+    json::Writer& writer) const
+{
+    json_reader_.ProcessStatRequest(stat_request, writer);
+}
+
+WorkerPool::WorkerPool(size_t workers_count)
+{
+    for (size_t i = 0; i < std::max<size_t>(workers_count, 1); ++i)
+    {
+        workers_.emplace_back([this] { Work(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+std::future<std::string> WorkerPool::Submit(std::function<std::string()> task)
+{
+    std::packaged_task<std::string()> packaged_task(std::move(task));
+    std::future<std::string> result = packaged_task.get_future();
+
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push_back(std::move(packaged_task));
+    }
+    tasks_cv_.notify_one();
+
+    return result;
+}
+
+void WorkerPool::Work()
+{
+    while (true)
+    {
+        std::packaged_task<std::string()> task;
+        {
+            std::unique_lock lock(mutex_);
+            tasks_cv_.wait(lock, [this]
+                {
+                    return is_stopping_ || !tasks_.empty();
+                });
+
+            if (tasks_.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+    }
+}
+
+QueryServer::QueryServer(const serialization::SerializationSettings& settings,
+    size_t workers_count, stats::Stats* stats)
+    : snapshot_(std::make_shared<const BaseSnapshot>(settings, stats))
+    , workers_(workers_count)
+    , stats_(stats)
+    , settings_(settings)
+    , file_time_(GetFileTime(settings.file_name))
+    , reloader_([this] { WatchBase(); })
+{
+}
+
+QueryServer::~QueryServer()
+{
+    {
+        std::lock_guard lock(reload_mutex_);
+        is_stopping_ = true;
+    }
+    reload_cv_.notify_all();
+    reloader_.join();
+}
+
+void QueryServer::Serve(std::istream& input, std::ostream& output)
+{
+    ServeConnection(
+        [&input](std::string& line)
+        {
+            return static_cast<bool>(std::getline(input, line));
+        },
+        [&output](const std::string& line)
+        {
+            output << line << '\n' << std::flush;
+        });
+}
+
+void QueryServer::ServeSocket(const std::string& socket_path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::invalid_argument("Socket path is too long");
+    }
+    address.sun_family = AF_UNIX;
+    socket_path.copy(address.sun_path, socket_path.size());
+
+    const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0)
+    {
+        throw std::runtime_error("Unable to create a socket for "
+            + socket_path);
+    }
+
+    unlink(socket_path.c_str());
+    if (bind(server_fd, reinterpret_cast<sockaddr*>(&address),
+            sizeof(address)) < 0
+        || listen(server_fd, SOMAXCONN) < 0)
+    {
+        close(server_fd);
+        throw std::runtime_error("Unable to listen on " + socket_path);
+    }
+
+    // Writes to a client that has gone must fail instead of killing the
+    // server, and SIGINT or SIGTERM end the accept loop
+    std::signal(SIGPIPE, SIG_IGN);
+    is_stop_requested = 0;
+    std::signal(SIGINT, RequestStop);
+    std::signal(SIGTERM, RequestStop);
+
+    // Descriptors are closed here only after their connection is over,
+    // so that a number is never reused while shutdown may still use it
+    std::vector<std::pair<int, std::future<void>>> connections;
+    const auto close_finished = [&connections]
+    {
+        for (auto it = connections.begin(); it != connections.end();)
+        {
+            if (it->second.wait_for(std::chrono::seconds(0))
+                == std::future_status::ready)
+            {
+                close(it->first);
+                it = connections.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    };
+
+    while (!is_stop_requested)
+    {
+        // The timeout lets a signal handled by another thread end the loop
+        pollfd server_poll{server_fd, POLLIN, 0};
+        if (poll(&server_poll, 1, ACCEPT_POLL_TIMEOUT_MS) <= 0)
+        {
+            close_finished();
+            continue;
+        }
+
+        const int client_fd = accept(server_fd, nullptr, nullptr);
+        close_finished();
+        if (client_fd < 0)
+        {
+            continue;
+        }
+
+        connections.emplace_back(client_fd, std::async(std::launch::async,
+            [this, client_fd]
+            {
+                std::string buffer;
+                ServeConnection(
+                    [client_fd, &buffer](std::string& line)
+                    {
+                        size_t end = buffer.find('\n');
+                        char chunk[4096];
+                        while (end == std::string::npos)
+                        {
+                            const ssize_t size = read(client_fd, chunk,
+                                sizeof(chunk));
+                            if (size <= 0)
+                            {
+                                line = std::move(buffer);
+                                buffer.clear();
+                                return !line.empty();
+                            }
+                            buffer.append(chunk, size);
+                            end = buffer.find('\n');
+                        }
+
+                        line = buffer.substr(0, end);
+                        buffer.erase(0, end + 1);
+                        return true;
+                    },
+                    [client_fd](const std::string& line)
+                    {
+                        const std::string data = line + '\n';
+                        for (size_t written = 0; written < data.size();)
+                        {
+                            const ssize_t size = write(client_fd,
+                                data.data() + written, data.size() - written);
+                            if (size <= 0)
+                            {
+                                return;
+                            }
+                            written += size;
+                        }
+                    });
+            }));
+    }
+
+    close(server_fd);
+    unlink(socket_path.c_str());
+
+    // Reads of open connections end at once, responses already computed
+    // are still written
+    for (auto& [client_fd, connection] : connections)
+    {
+        shutdown(client_fd, SHUT_RD);
+    }
+    for (auto& [client_fd, connection] : connections)
+    {
+        connection.wait();
+        close(client_fd);
+    }
+#else
+    throw std::logic_error("Unix domain sockets are not supported, "
+        "serve requests from stdin instead: " + socket_path);
+#endif
+}
+
+void QueryServer::PrintLatencyReport(std::ostream& output) const
+{
+    json::PrintCompact(json::Document{BuildLatencyReport()}, output);
+    output << '\n';
+}
+
+void QueryServer::WatchBase()
+{
+    while (true)
+    {
+        serialization::SerializationSettings settings = settings_;
+        bool is_requested = false;
+        {
+            std::unique_lock lock(reload_mutex_);
+            reload_cv_.wait_for(lock, BASE_CHECK_INTERVAL, [this]
+                {
+                    return is_stopping_ || requested_file_name_.has_value();
+                });
+
+            if (is_stopping_)
+            {
+                return;
+            }
+
+            is_requested = requested_file_name_.has_value();
+            if (is_requested && !requested_file_name_->empty())
+            {
+                settings.file_name = *requested_file_name_;
+            }
+            requested_file_name_.reset();
+        }
+
+        const auto file_time = GetFileTime(settings.file_name);
+        if (!is_requested && file_time == file_time_)
+        {
+            continue;
+        }
+
+        try
+        {
+            auto snapshot = std::make_shared<const BaseSnapshot>(settings,
+                stats_);
+            std::atomic_store(&snapshot_,
+                std::shared_ptr<const BaseSnapshot>(std::move(snapshot)));
+
+            settings_ = settings;
+            file_time_ = file_time;
+            std::cerr << "Base reloaded from "sv << settings.file_name << '\n';
+        }
+        catch (const std::exception& e)
+        {
+            if (settings.file_name == settings_.file_name)
+            {
+                // Do not retry the same broken file every check
+                file_time_ = file_time;
+            }
+            std::cerr << "Base reload failed: "sv << e.what() << '\n';
+        }
+    }
+}
+
+void QueryServer::ScheduleReload(const std::string& file_name)
+{
+    {
+        std::lock_guard lock(reload_mutex_);
+        requested_file_name_ = file_name;
+    }
+    reload_cv_.notify_all();
+}
+
+void QueryServer::ServeConnection(const LineReader& read_line,
+    const LineWriter& write_line)
+{
+    std::deque<std::future<std::string>> responses;
+    std::mutex mutex;
+    std::condition_variable responses_cv;
+    bool is_input_over = false;
+
+    std::thread writer([&]
+        {
+            while (true)
+            {
+                std::future<std::string> response;
+                {
+                    std::unique_lock lock(mutex);
+                    responses_cv.wait(lock, [&]
+                        {
+                            return is_input_over || !responses.empty();
+                        });
+
+                    if (responses.empty())
+                    {
+                        return;
+                    }
+                    response = std::move(responses.front());
+                }
+
+                write_line(response.get());
+
+                {
+                    std::lock_guard lock(mutex);
+                    responses.pop_front();
+                }
+                responses_cv.notify_all();
+            }
+        });
+
+    for (std::string line; read_line(line);)
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        std::future<std::string> response = workers_.Submit(
+            [this, line = std::move(line), start]
+            {
+                std::string result = ComputeResponse(line);
+                latency_.Add(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count());
+
+                return result;
+            });
+
+        std::unique_lock lock(mutex);
+        responses_cv.wait(lock, [&]
+            {
+                return responses.size() < MAX_REQUESTS_IN_FLIGHT;
+            });
+        responses.push_back(std::move(response));
+        responses_cv.notify_all();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        is_input_over = true;
+    }
+    responses_cv.notify_all();
+    writer.join();
+}
+
+std::string QueryServer::ComputeResponse(const std::string& line)
+{
+    std::ostringstream output;
+    json::Node request_id;
+
+    try
+    {
+        std::istringstream input(line);
+        const json::Document request = json::Load(input);
+        const json::Dict& request_dict = request.GetRoot().AsDict();
+        if (request_dict.count("id"))
+        {
+            request_id = request_dict.at("id");
+        }
+
+        if (request_dict.count("type")
+            && request_dict.at("type") == json::Node{"Stats"s})
+        {
+            json::Dict report = BuildLatencyReport().AsDict();
+            report["request_id"s] = request_id;
+            json::PrintCompact(json::Document{report}, output);
+        }
+        else if (request_dict.count("type")
+            && request_dict.at("type") == json::Node{"Reload"s})
+        {
+            ScheduleReload(request_dict.count("file")
+                ? request_dict.at("file").AsString() : ""s);
+            json::PrintCompact(json::Document{json::Builder{}.StartDict()
+                .Key("request_id"s).Value(request_id.GetValue())
+                .Key("reload_scheduled"s).Value(true)
+                .EndDict().Build()}, output);
+        }
+        else
+        {
+            const std::shared_ptr<const BaseSnapshot> snapshot =
+                std::atomic_load(&snapshot_);
+            json::Writer writer(output, 0, true);
+            snapshot->ProcessStatRequest(request.GetRoot(), writer);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // A response may have been partly written before the error
+        output.str(std::string{});
+        json::PrintCompact(json::Document{json::Builder{}.StartDict()
+            .Key("request_id"s).Value(request_id.GetValue())
+            .Key("error_message"s).Value(std::string(e.what()))
+            .EndDict().Build()}, output);
+    }
+
+    return output.str();
+}
+
+json::Node QueryServer::BuildLatencyReport() const
+{
+    return json::Builder{}.StartDict()
+        .Key("count"s).Value(static_cast<int>(latency_.GetCount()))
+        .Key("p50_ms"s).Value(latency_.GetPercentile(50.0))
+        .Key("p99_ms"s).Value(latency_.GetPercentile(99.0))
+        .EndDict().Build();
+}
+
+}  // namespace query_server
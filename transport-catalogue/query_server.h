@@ -0,0 +1,121 @@
+#pragma once
+
+#include "json.h"
+#include "json_reader.h"
+#include "serialization.h"
+#include "stats.h"
+#include "transport_catalogue.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace query_server {
+
+// Immutable loaded base. Queries hold a shared pointer to the snapshot
+// they started on, so a newer one can be swapped in at any moment.
+class BaseSnapshot {
+public:
+    explicit BaseSnapshot(const serialization::SerializationSettings& settings,
+        stats::Stats* stats = nullptr);
+
+    BaseSnapshot(const BaseSnapshot&) = delete;
+    BaseSnapshot& operator=(const BaseSnapshot&) = delete;
+
+    void ProcessStatRequest(const json::Node& stat_request,
+        json::Writer& writer) const;
+
+private:
+    transport_catalogue::TransportCatalogue catalogue_;
+    serialization::SerializationMachine serialization_machine_;
+    json_reader::JsonReader json_reader_;
+};
+
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t workers_count);
+
+    ~WorkerPool();
+
+    std::future<std::string> Submit(std::function<std::string()> task);
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::packaged_task<std::string()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable tasks_cv_;
+    bool is_stopping_ = false;
+
+    void Work();
+};
+
+// Answers newline-delimited JSON stat requests with the base loaded once.
+// Responses of a connection are written in the order of its requests,
+// one compact JSON per line. {"type": "Stats"} reports latency counters.
+// The base is reloaded in background when its file changes or on
+// {"type": "Reload", "file": ...}; requests never wait for a reload.
+class QueryServer {
+public:
+    using LineReader = std::function<bool(std::string&)>;
+    using LineWriter = std::function<void(const std::string&)>;
+
+    // Loading of every base and every stat request are added to stats
+    // when they are given
+    QueryServer(const serialization::SerializationSettings& settings,
+        size_t workers_count, stats::Stats* stats = nullptr);
+
+    ~QueryServer();
+
+    void Serve(std::istream& input, std::ostream& output);
+
+    // Accepts connections on a Unix domain socket until SIGINT or SIGTERM,
+    // then stops reading open connections and returns once their responses
+    // are written
+    void ServeSocket(const std::string& socket_path);
+
+    void PrintLatencyReport(std::ostream& output) const;
+
+private:
+    static constexpr size_t MAX_REQUESTS_IN_FLIGHT = 1024;
+    static constexpr std::chrono::seconds BASE_CHECK_INTERVAL{1};
+    static constexpr int ACCEPT_POLL_TIMEOUT_MS = 200;
+
+    std::shared_ptr<const BaseSnapshot> snapshot_;
+    WorkerPool workers_;
+    stats::LatencyHistogram latency_;
+    stats::Stats* stats_;
+
+    serialization::SerializationSettings settings_;
+    std::filesystem::file_time_type file_time_;
+    std::optional<std::string> requested_file_name_;
+    bool is_stopping_ = false;
+    std::mutex reload_mutex_;
+    std::condition_variable reload_cv_;
+    std::thread reloader_;
+
+    void WatchBase();
+
+    void ScheduleReload(const std::string& file_name);
+
+    void ServeConnection(const LineReader& read_line,
+        const LineWriter& write_line);
+
+    std::string ComputeResponse(const std::string& line);
+
+    json::Node BuildLatencyReport() const;
+};
+
+}  // namespace query_server
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <iterator>
+#include <stdexcept>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
@@ -33,6 +35,73 @@ private:
     It end_;
 };
 
+// View of a contiguous array owned by someone else
+template <typename T>
+class Span {
+public:
+    Span() = default;
+
+    Span(T* data, size_t size)
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    T* begin() const
+    {
+        return data_;
+    }
+
+    T* end() const
+    {
+        return data_ + size_;
+    }
+
+    T* data() const
+    {
+        return data_;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    T& operator[](size_t index) const
+    {
+        return data_[index];
+    }
+
+    T& at(size_t index) const
+    {
+        if (index >= size_)
+        {
+            throw std::out_of_range("Span index is out of range");
+        }
+
+        return data_[index];
+    }
+
+    T& front() const
+    {
+        return data_[0];
+    }
+
+    T& back() const
+    {
+        return data_[size_ - 1];
+    }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
 template <typename C>
 auto AsRange(const C& container)
 {
@@ -0,0 +1,168 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace raptor_router {
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue,
+    const transport_router::TransportRouterSettings& router_settings)
+    : catalogue_(catalogue)
+    , bus_wait_time_(router_settings.bus_wait_time)
+    , stop_routes_(catalogue.GetAllStops().size())
+{
+    const transport_router::TransportRouter router(router_settings);
+
+    for (const domain::Bus& bus : catalogue_.GetAllBuses())
+    {
+        if (bus.stops.size() < 2)
+        {
+            continue;
+        }
+
+        const uint32_t route_id = static_cast<uint32_t>(routes_.size());
+        Route& route = routes_.emplace_back(Route{&bus, {}, {}});
+        route.stops.reserve(bus.stops.size());
+        route.ride_times.reserve(bus.stops.size());
+
+        for (size_t i = 0; i < bus.stops.size(); ++i)
+        {
+            const uint32_t stop = bus.stops[i]->edge_id;
+            route.stops.push_back(stop);
+            const bool is_same_stop = i == 0 || bus.stops[i - 1] == bus.stops[i];
+            route.ride_times.push_back(is_same_stop ? 0.0
+                : router.ComputeEdgeWeight(catalogue_.GetDistance(
+                    bus.stops[i - 1], bus.stops[i])));
+
+            stop_routes_[stop].push_back({route_id, static_cast<uint32_t>(i)});
+        }
+    }
+}
+
+std::vector<domain::Journey> RaptorRouter::BuildAlternatives(
+    const domain::Stop* from, const domain::Stop* to) const
+{
+    const double INF = std::numeric_limits<double>::infinity();
+    const size_t stops_count = stop_routes_.size();
+    const uint32_t target = to->edge_id;
+
+    std::vector<std::vector<double>> arrivals{
+        std::vector<double>(stops_count, INF)};
+    std::vector<std::vector<Label>> labels{std::vector<Label>(stops_count,
+        Label{NONE, NONE, NONE})};
+    std::vector<double> best_arrival(stops_count, INF);
+    std::vector<uint32_t> first_position(routes_.size(), NONE);
+
+    std::vector<uint32_t> marked_stops{from->edge_id};
+    std::vector<bool> is_marked(stops_count, false);
+    std::vector<uint32_t> marked_routes;
+
+    arrivals[0][from->edge_id] = 0.0;
+    best_arrival[from->edge_id] = 0.0;
+
+    std::vector<domain::Journey> result;
+    for (size_t round = 1; !marked_stops.empty(); ++round)
+    {
+        for (const uint32_t stop : marked_stops)
+        {
+            is_marked[stop] = false;
+            for (const auto [route, position] : stop_routes_[stop])
+            {
+                if (first_position[route] == NONE)
+                {
+                    marked_routes.push_back(route);
+                }
+                first_position[route] = std::min(first_position[route],
+                    position);
+            }
+        }
+        marked_stops.clear();
+
+        arrivals.push_back(arrivals.back());
+        labels.emplace_back(stops_count, Label{NONE, NONE, NONE});
+        const std::vector<double>& prev_arrival = arrivals[round - 1];
+        std::vector<double>& arrival = arrivals[round];
+        std::vector<Label>& label = labels[round];
+
+        for (const uint32_t route_id : marked_routes)
+        {
+            const Route& route = routes_[route_id];
+            double time = INF;
+            uint32_t board_position = NONE;
+
+            for (uint32_t position = first_position[route_id];
+                position < route.stops.size(); ++position)
+            {
+                const uint32_t stop = route.stops[position];
+                time += route.ride_times[position];
+
+                if (board_position != NONE
+                    && stop != route.stops[board_position]
+                    && time < std::min(best_arrival[stop],
+                        best_arrival[target]))
+                {
+                    arrival[stop] = time;
+                    best_arrival[stop] = time;
+                    label[stop] = {route_id, board_position, position};
+
+                    if (!is_marked[stop])
+                    {
+                        is_marked[stop] = true;
+                        marked_stops.push_back(stop);
+                    }
+                }
+
+                if (prev_arrival[stop] + bus_wait_time_ < time)
+                {
+                    time = prev_arrival[stop] + bus_wait_time_;
+                    board_position = position;
+                }
+            }
+
+            first_position[route_id] = NONE;
+        }
+        marked_routes.clear();
+
+        if (label[target].route != NONE)
+        {
+            result.push_back(BuildJourney(from->edge_id, target, round,
+                arrivals, labels));
+        }
+    }
+
+    return result;
+}
+
+domain::Journey RaptorRouter::BuildJourney(uint32_t from, uint32_t to,
+    size_t round,
+    const std::vector<std::vector<double>>& arrivals,
+    const std::vector<std::vector<Label>>& labels) const
+{
+    const auto& stops = catalogue_.GetAllStops();
+
+    domain::Journey journey{arrivals[round][to], {}};
+    for (uint32_t stop = to; stop != from; --round)
+    {
+        while (labels[round][stop].route == NONE)
+        {
+            --round;
+        }
+
+        const Label& label = labels[round][stop];
+        const Route& route = routes_[label.route];
+        const uint32_t board_stop = route.stops[label.board_position];
+
+        journey.legs.push_back({&stops.at(board_stop), bus_wait_time_,
+            route.bus,
+            static_cast<uint16_t>(label.alight_position - label.board_position),
+            arrivals[round][stop] - arrivals[round - 1][board_stop]
+                - bus_wait_time_});
+
+        stop = board_stop;
+    }
+    std::reverse(journey.legs.begin(), journey.legs.end());
+
+    return journey;
+}
+
+}  // namespace raptor_router
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace raptor_router {
+
+using TransportCatalogue = transport_catalogue::TransportCatalogue;
+
+// Round-based (RAPTOR) routing over the bus/stop structure of the catalogue
+// with the bus_wait_time/bus_velocity model of TransportRouter. Round k
+// finds the fastest journeys with exactly k buses, which gives the Pareto
+// set of (total time, number of transfers).
+class RaptorRouter {
+public:
+     RaptorRouter(const TransportCatalogue& catalogue,
+          const transport_router::TransportRouterSettings& router_settings);
+
+     // Journeys ordered by number of transfers, each one faster than the
+     // previous; empty if the stop is unreachable
+     std::vector<domain::Journey> BuildAlternatives(const domain::Stop* from,
+          const domain::Stop* to) const;
+
+private:
+     struct Route {
+          const domain::Bus* bus;
+          std::vector<uint32_t> stops;
+          std::vector<double> ride_times;
+     };
+
+     struct RoutePosition {
+          uint32_t route;
+          uint32_t position;
+     };
+
+     struct Label {
+          uint32_t route;
+          uint32_t board_position;
+          uint32_t alight_position;
+     };
+
+     static constexpr uint32_t NONE = UINT32_MAX;
+
+     const TransportCatalogue& catalogue_;
+     double bus_wait_time_;
+     std::vector<Route> routes_;
+     std::vector<std::vector<RoutePosition>> stop_routes_;
+
+     domain::Journey BuildJourney(uint32_t from, uint32_t to, size_t round,
+          const std::vector<std::vector<double>>& arrivals,
+          const std::vector<std::vector<Label>>& labels) const;
+};
+
+}  // namespace raptor_router
@@ -8,25 +8,42 @@ MapRequestHandler::MapRequestHandler(const TransportCatalogue& db,
 {
 }
 
-const std::map<std::string, domain::Bus*> MapRequestHandler::GetRoutes() const
+svg::Document MapRequestHandler::RenderMap() const
 {
-    return db_.GetRoutes();
+    return renderer_.RenderMap(db_.GetAllBuses(), db_.GetBusIdsByName(),
+        db_.GetStopTable());
 }
-    
-svg::Document MapRequestHandler::RenderMap() const
+
+svg::Document MapRequestHandler::RenderIsochrone(
+    const std::vector<std::pair<const domain::Stop*, double>>& reachable,
+    double max_time) const
 {
-    return renderer_.RenderMap(GetRoutes());
+    return renderer_.RenderIsochrone(db_.GetAllBuses(),
+        db_.GetBusIdsByName(), db_.GetStopTable(), reachable, max_time);
 }
 
-RouterRequestHandler::RouterRequestHandler(const graph::Router<double>& router)
+RouterRequestHandler::RouterRequestHandler(const transport_router::Router& router)
     : router_(router)
 {
 }
 
-std::optional<graph::Router<double>::RouteInfo> RouterRequestHandler::BuildRoute(
+std::optional<transport_router::Router::RouteInfo> RouterRequestHandler::BuildRoute(
     graph::VertexId from, graph::VertexId to) const
 {
     return router_.BuildRoute(from, to);
 }
 
+std::optional<transport_router::Weight> RouterRequestHandler::BuildRoute(graph::VertexId from,
+    graph::VertexId to, std::vector<graph::EdgeId>& edges) const
+{
+    return router_.BuildRoute(from, to, edges);
+}
+
+std::vector<std::optional<transport_router::Weight>>
+RouterRequestHandler::GetRouteWeights(graph::VertexId from,
+    const std::vector<graph::VertexId>& targets) const
+{
+    return router_.GetRouteWeights(from, targets);
+}
+
 }
@@ -3,8 +3,10 @@
 #include "map_renderer.h"
 #include "router.h"
 #include "transport_catalogue.h"
+#include "transport_router.h"
 
 #include <optional>
+#include <vector>
 
 using transport_catalogue::TransportCatalogue;
 
@@ -15,10 +17,12 @@ public:
     MapRequestHandler(const TransportCatalogue& db,
         const map_renderer::MapRenderer& renderer);
 
-    const std::map<std::string, domain::Bus*> GetRoutes() const;
-
     svg::Document RenderMap() const;
 
+    svg::Document RenderIsochrone(
+        const std::vector<std::pair<const domain::Stop*, double>>& reachable,
+        double max_time) const;
+
 private:
     const TransportCatalogue& db_;
     const map_renderer::MapRenderer& renderer_;
@@ -26,13 +30,19 @@ private:
 
 class RouterRequestHandler {
 public:
-    RouterRequestHandler(const graph::Router<double>& router);
+    RouterRequestHandler(const transport_router::Router& router);
     
-    std::optional<graph::Router<double>::RouteInfo> BuildRoute(
+    std::optional<transport_router::Router::RouteInfo> BuildRoute(
         graph::VertexId from, graph::VertexId to) const;
 
+    std::optional<transport_router::Weight> BuildRoute(graph::VertexId from, graph::VertexId to,
+        std::vector<graph::EdgeId>& edges) const;
+
+    std::vector<std::optional<transport_router::Weight>> GetRouteWeights(
+        graph::VertexId from, const std::vector<graph::VertexId>& targets) const;
+
 private:
-    const graph::Router<double>& router_;
+    const transport_router::Router& router_;
 };
 
 }
@@ -1,12 +1,20 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus.h"
+#include "trace.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <queue>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -20,8 +28,16 @@ private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
+    // Kernels of the all-pairs build with identical results: DENSE relaxes
+    // whole rows of a plain weights table with SIMD, CELLS goes cell by
+    // cell over the optional routes and is kept as the reference
+    enum class Kernel {
+        DENSE,
+        CELLS,
+    };
+
     Router() = default;
-    explicit Router(Graph& graph, bool is_dummy);
+    explicit Router(Graph& graph, bool is_dummy, Kernel kernel = Kernel::DENSE);
 
     struct RouteInfo {
         Weight weight;
@@ -30,14 +46,39 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Same as above, but puts the edges of the route into a buffer owned by
+    // the caller, so that no memory is allocated once it is large enough
+    std::optional<Weight> BuildRoute(VertexId from, VertexId to,
+                                     std::vector<EdgeId>& edges) const;
+
+    std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const;
+
+    // Weights of the routes from a vertex to every one of targets, nothing
+    // for unreachable ones. The shortest paths tree of the source is summed
+    // up once for all of them
+    std::vector<std::optional<Weight>> GetRouteWeights(VertexId from,
+                                                       const std::vector<VertexId>& targets) const;
+
+    // Edge ids are kept in 32 bits as in PredecessorsFrom, which with
+    // 32-bit weights halves the table
     struct RouteInternalData {
         Weight weight;
-        std::optional<EdgeId> prev_edge;
+        std::optional<uint32_t> prev_edge;
     };
 
-    using RoutesInternalData = std::vector<std::vector<std::optional<
-        RouteInternalData>>>;
+    using RoutesFrom = std::vector<std::optional<RouteInternalData>>;
+    using RoutesInternalData = std::vector<RoutesFrom>;
 
+    // Shortest paths tree from one source: the last edge of the route to
+    // every vertex, NO_EDGE for the source itself and NO_ROUTE for
+    // unreachable vertices. Weights are summed up along the path
+    using PredecessorsFrom = std::vector<uint32_t>;
+    using PredecessorsLoader = std::function<PredecessorsFrom(VertexId)>;
+
+    static constexpr uint32_t NO_ROUTE = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t NO_EDGE = NO_ROUTE - 1;
+
+    // Holds all routes unless a predecessors loader is set
     const RoutesInternalData& GetRIDs() const
     {
         return routes_internal_data_;
@@ -46,16 +87,133 @@ public:
     void SetRIDs(RoutesInternalData& rids)
     {
         routes_internal_data_ = std::move(rids);
+        predecessors_loader_ = nullptr;
+        predecessors_cache_ = nullptr;
+        pending_update_ = std::nullopt;
     }
 
-    void SetGraph(const graph::DirectedWeightedGraph<double>& graph)
+    // Routes from a vertex are then obtained from loader the first time
+    // they are needed instead of being held all at once. Loaded trees are
+    // cached while their total size fits into cache_size bytes
+    void SetPredecessorsLoader(size_t vertex_count, PredecessorsLoader loader,
+                               size_t cache_size)
+    {
+        routes_internal_data_.clear();
+        predecessors_loader_ = std::move(loader);
+        predecessors_cache_ = std::make_unique<PredecessorsCache>();
+        predecessors_cache_->vertex_count = vertex_count;
+        predecessors_cache_->capacity = cache_size;
+        pending_update_ = std::nullopt;
+    }
+
+    void SetGraph(const Graph& graph)
     {
         graph_ = graph;        
     }
 
+    // Brings routes up to date after the graph was replaced by one with the
+    // same vertices plus possibly new ones appended. Sources whose shortest
+    // paths tree lost an edge are recomputed; in the other rows only routes
+    // that get shorter through added edges are relaxed, so their trees are
+    // otherwise kept. The table is updated in place row by row. Rows of a
+    // predecessors loader are updated as they are loaded, so nothing is
+    // computed until a row is asked for. Throws if rows of the loader are
+    // still to be updated by a previous call
+    void UpdateRoutes(const EdgesDiff& edges_diff);
+
+    // Shortest paths tree from a vertex, taken from the table or loaded.
+    // It is not cached, so that going through all vertices holds one row
+    // at a time
+    PredecessorsFrom LoadPredecessorsFrom(VertexId from) const;
+
 private:
+    // Least recently used rows go last
+    struct PredecessorsCache {
+        using Rows = std::list<std::pair<VertexId, std::shared_ptr<const PredecessorsFrom>>>;
+
+        std::mutex mutex;
+        Rows rows;
+        std::unordered_map<VertexId, typename Rows::iterator> positions;
+        size_t vertex_count = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    // Rows of the loader belong to the graph before the update and are
+    // brought up to date as they are loaded
+    struct PendingUpdate {
+        EdgesDiff edges_diff;
+        size_t vertex_count = 0;
+    };
+
+    std::shared_ptr<const PredecessorsFrom> GetPredecessorsFrom(VertexId from) const;
+
+    // Row of the loader for the current graph
+    PredecessorsFrom LoadUpdatedPredecessorsFrom(VertexId from) const;
+
+    static PredecessorsFrom ToPredecessorsFrom(const RoutesFrom& routes_from)
+    {
+        PredecessorsFrom predecessors(routes_from.size(), NO_ROUTE);
+        for (size_t vertex = 0; vertex < routes_from.size(); ++vertex)
+        {
+            if (routes_from[vertex])
+            {
+                predecessors[vertex] = routes_from[vertex]->prev_edge.value_or(NO_EDGE);
+            }
+        }
+
+        return predecessors;
+    }
+
+    // Recovers weights of a whole shortest paths tree, walking every path
+    // only up to a vertex whose weight is already known
+    RoutesFrom BuildRoutesFrom(const PredecessorsFrom& predecessors) const
+    {
+        RoutesFrom routes_from(predecessors.size());
+        std::vector<VertexId> path;
+        for (VertexId vertex_to = 0; vertex_to < predecessors.size(); ++vertex_to)
+        {
+            for (VertexId vertex = vertex_to;
+                 !routes_from[vertex] && predecessors[vertex] != NO_ROUTE;
+                 vertex = graph_.GetEdge(predecessors[vertex]).from)
+            {
+                path.push_back(vertex);
+                if (predecessors[vertex] == NO_EDGE || path.size() > predecessors.size())
+                {
+                    break;
+                }
+            }
+
+            for (auto it = path.rbegin(); it != path.rend(); ++it)
+            {
+                const uint32_t edge_id = predecessors[*it];
+                if (edge_id == NO_EDGE)
+                {
+                    routes_from[*it] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+                    continue;
+                }
+
+                const auto& edge = graph_.GetEdge(edge_id);
+                if (!routes_from[edge.from])
+                {
+                    throw std::runtime_error("Shortest paths tree is broken");
+                }
+                routes_from[*it] = RouteInternalData{routes_from[edge.from]->weight + edge.weight,
+                                                     edge_id};
+            }
+            path.clear();
+        }
+
+        return routes_from;
+    }
+
     void InitializeRoutesInternalData(const Graph& graph)
     {
+        if (graph.GetEdgeCount() >= NO_EDGE)
+        {
+            throw std::length_error("Too many edges for the router");
+        }
+
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
         {
@@ -76,6 +234,79 @@ private:
         }
     }
 
+    // Floyd-Warshall over a dense table where missing routes weigh
+    // NO_ROUTE_WEIGHT, so that rows are relaxed without branches. The
+    // result is then moved into routes_internal_data_ row by row
+    void BuildDenseRoutesInternalData(const Graph& graph)
+    {
+        if (graph.GetEdgeCount() >= NO_EDGE)
+        {
+            throw std::length_error("Too many edges for the router");
+        }
+
+        const size_t vertex_count = graph.GetVertexCount();
+        std::vector<Weight> weights(vertex_count * vertex_count, NO_ROUTE_WEIGHT);
+        std::vector<uint32_t> prev_edges(vertex_count * vertex_count, NO_ROUTE);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex)
+        {
+            weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+            prev_edges[vertex * vertex_count + vertex] = NO_EDGE;
+            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex))
+            {
+                const auto& edge = graph.GetEdge(edge_id);
+                if (edge.weight < ZERO_WEIGHT)
+                {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const size_t cell = vertex * vertex_count + edge.to;
+                if (edge.weight < weights[cell])
+                {
+                    weights[cell] = edge.weight;
+                    prev_edges[cell] = static_cast<uint32_t>(edge_id);
+                }
+            }
+        }
+
+        // Routes from the vertex relaxed through cannot get shorter through
+        // it, and neither can routes to it, so the rows being read are never
+        // written meanwhile
+        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through)
+        {
+            const size_t through_row = vertex_through * vertex_count;
+            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from)
+            {
+                const size_t row = vertex_from * vertex_count;
+                const Weight through = weights[row + vertex_through];
+                if (vertex_from == vertex_through || !(through < NO_ROUTE_WEIGHT))
+                {
+                    continue;
+                }
+
+                min_plus::RelaxRow(through, &weights[through_row],
+                                   &prev_edges[through_row], &weights[row],
+                                   &prev_edges[row], vertex_count);
+            }
+        }
+
+        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from)
+        {
+            RoutesFrom& routes_from = routes_internal_data_[vertex_from];
+            const size_t row = vertex_from * vertex_count;
+            for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to)
+            {
+                const uint32_t prev_edge = prev_edges[row + vertex_to];
+                if (prev_edge == NO_ROUTE)
+                {
+                    continue;
+                }
+
+                routes_from[vertex_to] = RouteInternalData{
+                    weights[row + vertex_to],
+                    prev_edge == NO_EDGE ? std::nullopt : std::optional<uint32_t>(prev_edge)};
+            }
+        }
+    }
+
     void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
                     const RouteInternalData& route_to)
     {
@@ -105,18 +336,138 @@ private:
         }
     }
 
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Dijkstra over the whole graph from a single source
+    RoutesFrom ComputeRoutesFrom(VertexId vertex_from) const
+    {
+        RoutesFrom routes_from(graph_.GetVertexCount());
+        routes_from[vertex_from] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+
+        std::priority_queue<QueueItem, std::vector<QueueItem>,
+                            std::greater<QueueItem>> queue;
+        queue.push({ZERO_WEIGHT, vertex_from});
+        RelaxQueue(routes_from, queue);
+
+        return routes_from;
+    }
+
+    // Relaxes routes of a row through added edges and then through every
+    // edge after the vertices that got closer. Routes of the row have to be
+    // shortest for the graph without the added edges
+    void RelaxAddedEdges(RoutesFrom& routes_from, const std::vector<EdgeId>& added) const
+    {
+        std::priority_queue<QueueItem, std::vector<QueueItem>,
+                            std::greater<QueueItem>> queue;
+        for (const EdgeId edge_id : added)
+        {
+            const auto& edge = graph_.GetEdge(edge_id);
+            if (!routes_from[edge.from])
+            {
+                continue;
+            }
+
+            const Weight candidate_weight = routes_from[edge.from]->weight + edge.weight;
+            auto& route_relaxing = routes_from[edge.to];
+            if (!route_relaxing || candidate_weight < route_relaxing->weight)
+            {
+                route_relaxing = RouteInternalData{candidate_weight, edge_id};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+        RelaxQueue(routes_from, queue);
+    }
+
+    template <typename Queue>
+    void RelaxQueue(RoutesFrom& routes_from, Queue& queue) const
+    {
+        while (!queue.empty())
+        {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weight > routes_from[vertex]->weight)
+            {
+                continue;
+            }
+
+            for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex))
+            {
+                const auto& edge = graph_.GetEdge(edge_id);
+                const Weight candidate_weight = weight + edge.weight;
+                auto& route_relaxing = routes_from[edge.to];
+                if (!route_relaxing || candidate_weight < route_relaxing->weight)
+                {
+                    route_relaxing = RouteInternalData{candidate_weight, edge_id};
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+    }
+
+    // Renumbers edges of a row of the previous graph by the diff. Returns
+    // false if its shortest paths tree lost an edge
+    static bool RenumberPredecessors(PredecessorsFrom& predecessors,
+                                     const EdgesDiff& edges_diff)
+    {
+        for (uint32_t& edge_id : predecessors)
+        {
+            if (edge_id == NO_ROUTE || edge_id == NO_EDGE)
+            {
+                continue;
+            }
+            const auto current = edges_diff.previous_to_current.at(edge_id);
+            if (!current)
+            {
+                return false;
+            }
+            edge_id = static_cast<uint32_t>(*current);
+        }
+
+        return true;
+    }
+
+    static bool RenumberRoutesFrom(RoutesFrom& routes_from, const EdgesDiff& edges_diff)
+    {
+        for (auto& route : routes_from)
+        {
+            if (route && route->prev_edge)
+            {
+                const auto current = edges_diff.previous_to_current.at(*route->prev_edge);
+                if (!current)
+                {
+                    return false;
+                }
+                route->prev_edge = static_cast<uint32_t>(*current);
+            }
+        }
+
+        return true;
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
+    // Weight of a missing route in the dense table: adding any route weight
+    // to it neither overflows nor gets below it
+    static constexpr Weight NO_ROUTE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+        ? std::numeric_limits<Weight>::infinity()
+        : std::numeric_limits<Weight>::max() / 2;
     Graph& graph_;
     RoutesInternalData routes_internal_data_;
+    PredecessorsLoader predecessors_loader_;
+    std::unique_ptr<PredecessorsCache> predecessors_cache_;
+    std::optional<PendingUpdate> pending_update_;
 };
 
 template <typename Weight>
-Router<Weight>::Router(Graph& graph, bool is_dummy)
+Router<Weight>::Router(Graph& graph, bool is_dummy, Kernel kernel)
     : graph_(graph)
     , routes_internal_data_(graph.GetVertexCount(),
                             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
-    if (!is_dummy)
+    if (!is_dummy && kernel == Kernel::DENSE)
+    {
+        BuildDenseRoutesInternalData(graph);
+    }
+    else if (!is_dummy)
     {
         InitializeRoutesInternalData(graph);
 
@@ -128,26 +479,267 @@ Router<Weight>::Router(Graph& graph, bool is_dummy)
     }
 }
 
+template <typename Weight>
+void Router<Weight>::UpdateRoutes(const EdgesDiff& edges_diff)
+{
+    if (graph_.GetEdgeCount() >= NO_EDGE)
+    {
+        throw std::length_error("Too many edges for the router");
+    }
+
+    if (predecessors_loader_)
+    {
+        if (pending_update_)
+        {
+            throw std::logic_error("Routes are already being updated");
+        }
+
+        PredecessorsCache& cache = *predecessors_cache_;
+        std::lock_guard lock(cache.mutex);
+        pending_update_ = PendingUpdate{edges_diff, cache.vertex_count};
+        cache.rows.clear();
+        cache.positions.clear();
+        cache.size = 0;
+        cache.vertex_count = graph_.GetVertexCount();
+
+        return;
+    }
+
+    const size_t previous_vertex_count = routes_internal_data_.size();
+    routes_internal_data_.resize(graph_.GetVertexCount());
+    for (VertexId vertex_from = 0; vertex_from < routes_internal_data_.size(); ++vertex_from)
+    {
+        RoutesFrom& routes_from = routes_internal_data_[vertex_from];
+        if (vertex_from < previous_vertex_count && routes_from[vertex_from]
+            && RenumberRoutesFrom(routes_from, edges_diff))
+        {
+            routes_from.resize(graph_.GetVertexCount());
+            RelaxAddedEdges(routes_from, edges_diff.added);
+        }
+        else
+        {
+            routes_from = ComputeRoutesFrom(vertex_from);
+        }
+    }
+}
+
+template <typename Weight>
+typename Router<Weight>::PredecessorsFrom Router<Weight>::LoadPredecessorsFrom(VertexId from) const
+{
+    if (predecessors_loader_)
+    {
+        if (from >= predecessors_cache_->vertex_count)
+        {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+
+        return LoadUpdatedPredecessorsFrom(from);
+    }
+
+    return ToPredecessorsFrom(routes_internal_data_.at(from));
+}
+
+template <typename Weight>
+typename Router<Weight>::PredecessorsFrom
+Router<Weight>::LoadUpdatedPredecessorsFrom(VertexId from) const
+{
+    if (!pending_update_)
+    {
+        return predecessors_loader_(from);
+    }
+
+    const auto& [edges_diff, previous_vertex_count] = *pending_update_;
+    if (from < previous_vertex_count)
+    {
+        PredecessorsFrom predecessors = predecessors_loader_(from);
+        if (RenumberPredecessors(predecessors, edges_diff))
+        {
+            predecessors.resize(graph_.GetVertexCount(), NO_ROUTE);
+            if (edges_diff.added.empty())
+            {
+                return predecessors;
+            }
+
+            RoutesFrom routes_from = BuildRoutesFrom(predecessors);
+            RelaxAddedEdges(routes_from, edges_diff.added);
+
+            return ToPredecessorsFrom(routes_from);
+        }
+    }
+
+    return ToPredecessorsFrom(ComputeRoutesFrom(from));
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const
 {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+    std::vector<EdgeId> edges;
+    const auto weight = BuildRoute(from, to, edges);
+    if (!weight)
+    {
+        return std::nullopt;
+    }
+
+    return RouteInfo{*weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::optional<Weight> Router<Weight>::BuildRoute(VertexId from, VertexId to,
+                                                 std::vector<EdgeId>& edges) const
+{
+    const trace::Span span("router", "Router::BuildRoute");
+    edges.clear();
+    if (predecessors_loader_)
+    {
+        const auto predecessors = GetPredecessorsFrom(from);
+        uint32_t edge_id = predecessors->at(to);
+        if (edge_id == NO_ROUTE)
+        {
+            return std::nullopt;
+        }
+
+        for (; edge_id != NO_EDGE; edge_id = (*predecessors)[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        Weight weight = ZERO_WEIGHT;
+        for (const EdgeId edge : edges)
+        {
+            weight += graph_.GetEdge(edge).weight;
+        }
+
+        return weight;
+    }
+
+    if (from >= routes_internal_data_.size() || to >= routes_internal_data_.size())
+    {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const RoutesFrom& routes_from = routes_internal_data_[from];
+    const auto& route_internal_data = routes_from[to];
     if (!route_internal_data)
     {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
-    std::vector<EdgeId> edges;
     for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = routes_from[graph_.GetEdge(*edge_id).from]->prev_edge)
     {
         edges.push_back(*edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    return route_internal_data->weight;
+}
+
+template <typename Weight>
+std::optional<Weight> Router<Weight>::GetRouteWeight(VertexId from,
+                                                     VertexId to) const
+{
+    if (predecessors_loader_)
+    {
+        const auto predecessors = GetPredecessorsFrom(from);
+        uint32_t edge_id = predecessors->at(to);
+        if (edge_id == NO_ROUTE)
+        {
+            return std::nullopt;
+        }
+
+        Weight weight = ZERO_WEIGHT;
+        for (; edge_id != NO_EDGE; edge_id = (*predecessors)[graph_.GetEdge(edge_id).from])
+        {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+
+        return weight;
+    }
+
+    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
+    if (!route_internal_data)
+    {
+        return std::nullopt;
+    }
+
+    return route_internal_data->weight;
+}
+
+template <typename Weight>
+std::vector<std::optional<Weight>> Router<Weight>::GetRouteWeights(
+    VertexId from, const std::vector<VertexId>& targets) const
+{
+    std::vector<std::optional<Weight>> weights;
+    weights.reserve(targets.size());
+
+    const auto add_weights = [&weights, &targets](const RoutesFrom& routes_from)
+    {
+        for (const VertexId to : targets)
+        {
+            const auto& route_internal_data = routes_from.at(to);
+            weights.push_back(route_internal_data ? std::optional<Weight>(route_internal_data->weight)
+                                                  : std::nullopt);
+        }
+    };
+
+    if (predecessors_loader_)
+    {
+        add_weights(BuildRoutesFrom(*GetPredecessorsFrom(from)));
+    }
+    else
+    {
+        add_weights(routes_internal_data_.at(from));
+    }
+
+    return weights;
+}
+
+template <typename Weight>
+std::shared_ptr<const typename Router<Weight>::PredecessorsFrom>
+Router<Weight>::GetPredecessorsFrom(VertexId from) const
+{
+    PredecessorsCache& cache = *predecessors_cache_;
+    if (from >= cache.vertex_count)
+    {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    {
+        std::lock_guard lock(cache.mutex);
+        if (const auto it = cache.positions.find(from); it != cache.positions.end())
+        {
+            cache.rows.splice(cache.rows.begin(), cache.rows, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Loads without the lock, so that other rows are served meanwhile
+    std::shared_ptr<const PredecessorsFrom> predecessors;
+    {
+        const trace::Span span("router", "Router::LoadPredecessors");
+        predecessors = std::make_shared<const PredecessorsFrom>(LoadUpdatedPredecessorsFrom(from));
+    }
+
+    std::lock_guard lock(cache.mutex);
+    if (const auto it = cache.positions.find(from); it != cache.positions.end())
+    {
+        return it->second->second;
+    }
+
+    cache.rows.emplace_front(from, predecessors);
+    cache.positions[from] = cache.rows.begin();
+    cache.size += predecessors->size() * sizeof(uint32_t);
+    while (cache.size > cache.capacity && cache.rows.size() > 1)
+    {
+        const auto& [vertex, row] = cache.rows.back();
+        cache.size -= row->size() * sizeof(uint32_t);
+        cache.positions.erase(vertex);
+        cache.rows.pop_back();
+    }
+
+    return predecessors;
 }
 
 }  // namespace graph
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Weights, last edges and the queue of a single-source search, kept
+// between searches so that no memory is allocated once they are large
+// enough. Instead of clearing the arrays, Reset bumps a stamp: entries
+// written under an older stamp read as unreached
+template <typename Weight>
+class SearchWorkspace {
+public:
+    using QueueItem = std::pair<Weight, VertexId>;
+
+    // Workspace of the calling thread, shared by all searches on it
+    static SearchWorkspace& GetForThread();
+
+    void Reset(size_t vertex_count);
+
+    bool IsReached(VertexId vertex) const;
+    bool IsSettled(VertexId vertex) const;
+    Weight GetWeight(VertexId vertex) const;
+    EdgeId GetPrevEdge(VertexId vertex) const;
+
+    void Reach(VertexId vertex, Weight weight, EdgeId prev_edge);
+    void Settle(VertexId vertex);
+
+    // Min-heap of reached vertices by weight, ties broken by vertex id
+    bool IsQueueEmpty() const;
+    void Push(Weight weight, VertexId vertex);
+    QueueItem Pop();
+
+private:
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> prev_edges_;
+    std::vector<uint32_t> reached_stamps_;
+    std::vector<uint32_t> settled_stamps_;
+    std::vector<QueueItem> queue_;
+    uint32_t stamp_ = 0;
+};
+
+template <typename Weight>
+SearchWorkspace<Weight>& SearchWorkspace<Weight>::GetForThread()
+{
+    thread_local SearchWorkspace workspace;
+
+    return workspace;
+}
+
+template <typename Weight>
+void SearchWorkspace<Weight>::Reset(size_t vertex_count)
+{
+    if (weights_.size() < vertex_count)
+    {
+        weights_.resize(vertex_count);
+        prev_edges_.resize(vertex_count);
+        reached_stamps_.resize(vertex_count, 0);
+        settled_stamps_.resize(vertex_count, 0);
+    }
+
+    // Stamps left from 2^32 searches ago would look current again
+    if (++stamp_ == 0)
+    {
+        std::fill(reached_stamps_.begin(), reached_stamps_.end(), 0);
+        std::fill(settled_stamps_.begin(), settled_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+    queue_.clear();
+}
+
+template <typename Weight>
+bool SearchWorkspace<Weight>::IsReached(VertexId vertex) const
+{
+    return reached_stamps_[vertex] == stamp_;
+}
+
+template <typename Weight>
+bool SearchWorkspace<Weight>::IsSettled(VertexId vertex) const
+{
+    return settled_stamps_[vertex] == stamp_;
+}
+
+template <typename Weight>
+Weight SearchWorkspace<Weight>::GetWeight(VertexId vertex) const
+{
+    return weights_[vertex];
+}
+
+template <typename Weight>
+EdgeId SearchWorkspace<Weight>::GetPrevEdge(VertexId vertex) const
+{
+    return prev_edges_[vertex];
+}
+
+template <typename Weight>
+void SearchWorkspace<Weight>::Reach(VertexId vertex, Weight weight,
+    EdgeId prev_edge)
+{
+    weights_[vertex] = weight;
+    prev_edges_[vertex] = prev_edge;
+    reached_stamps_[vertex] = stamp_;
+}
+
+template <typename Weight>
+void SearchWorkspace<Weight>::Settle(VertexId vertex)
+{
+    settled_stamps_[vertex] = stamp_;
+}
+
+template <typename Weight>
+bool SearchWorkspace<Weight>::IsQueueEmpty() const
+{
+    return queue_.empty();
+}
+
+template <typename Weight>
+void SearchWorkspace<Weight>::Push(Weight weight, VertexId vertex)
+{
+    queue_.emplace_back(weight, vertex);
+    std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueItem>{});
+}
+
+template <typename Weight>
+typename SearchWorkspace<Weight>::QueueItem SearchWorkspace<Weight>::Pop()
+{
+    std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueItem>{});
+    const QueueItem item = queue_.back();
+    queue_.pop_back();
+
+    return item;
+}
+
+}  // namespace graph
@@ -2,53 +2,330 @@
 
 namespace serialization {
 
+namespace {
+
+// Calls func for every index in [0, count) on all hardware threads and
+// rethrows the first exception after all of them are done
+template <typename Func>
+void ParallelFor(size_t count, const Func& func)
+{
+    std::atomic<size_t> next_index = 0;
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+
+    const auto work = [&]
+        {
+            for (size_t i = next_index++; i < count; i = next_index++)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard lock(error_mutex);
+                    error = error ? error : std::current_exception();
+                }
+            }
+        };
+
+    const size_t threads_count = std::min<size_t>(count,
+        std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threads_count; ++i)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+}
+
 SerializationMachine::SerializationMachine(TransportCatalogue& catalogue)
     : catalogue_(catalogue)
 {
 }
 
-void SerializationMachine::SetSettings(const std::string& file_name)
+void SerializationMachine::SetSettings(const SerializationSettings& settings)
+{
+    serialization_settings_ = settings;
+}
+
+const SerializationSettings& SerializationMachine::GetSettings() const
 {
-    serialization_settings_.file_name = file_name;
+    return serialization_settings_;
 }
 
 void SerializationMachine::Serialize(
     const map_renderer::RenderSettingsRequest& render_settings,
     const transport_router::TransportRouterSettings& router_settings,
-    const graph::DirectedWeightedGraph<double>& graph,
-    const graph::Router<double>& router)
-{
-    std::ofstream ofs(serialization_settings_.file_name.c_str(),
-        std::ios::binary);
+    const transport_router::Graph& graph,
+    const transport_router::Router& router)
+{
+    const trace::Span span("serialization", "SerializationMachine::Serialize");
+
+    using transport_catalogue_serialize::Chunk;
+    using SliceSerializer = std::function<void(size_t, size_t, Base&)>;
+
+    std::vector<EncodedChunk> chunks;
+    std::vector<std::function<void(EncodedChunk&)>> encoders;
+    const auto add_slices = [&chunks, &encoders](Section section,
+        size_t count, size_t slice_size, const SliceSerializer& serializer)
+        {
+            for (size_t first = 0; first < count; first += slice_size)
+            {
+                const size_t last = std::min(count, first + slice_size);
+                chunks.push_back({section, first, {}});
+                encoders.push_back([serializer, first, last](
+                    EncodedChunk& chunk)
+                    {
+                        Base base;
+                        serializer(first, last, base);
+                        chunk.data = base.SerializeAsString();
+                    });
+            }
+        };
+
+    std::vector<const TransportCatalogue::StopsToDistance::value_type*>
+        distances;
+    for (const auto& element : catalogue_.GetStopsToDistance())
+    {
+        distances.push_back(&element);
+    }
+
+    add_slices(Chunk::STOPS, catalogue_.GetAllStops().size(), ITEMS_PER_CHUNK,
+        [this](size_t first, size_t last, Base& chunk)
+        {
+            SerializeStops(first, last, chunk);
+        });
+    add_slices(Chunk::STOPS_TO_DISTANCE, distances.size(), ITEMS_PER_CHUNK,
+        [this, &distances](size_t first, size_t last, Base& chunk)
+        {
+            SerializeStopsToDistance(distances, first, last, chunk);
+        });
+    add_slices(Chunk::BUSES, catalogue_.GetAllBuses().size(), ITEMS_PER_CHUNK,
+        [this](size_t first, size_t last, Base& chunk)
+        {
+            SerializeBuses(first, last, chunk);
+        });
+    add_slices(Chunk::STOP_BUSES, catalogue_.GetAllStops().size(),
+        ITEMS_PER_CHUNK, [this](size_t first, size_t last, Base& chunk)
+        {
+            SerializeStopBuses(first, last, chunk);
+        });
+    add_slices(Chunk::SETTINGS, 1, 1,
+        [this, &render_settings, &router_settings](size_t, size_t, Base& chunk)
+        {
+            SerializeRenderSettings(render_settings, chunk);
+            SerializeRouterSettings(router_settings, chunk);
+        });
+    add_slices(Chunk::GRAPH_EDGES, graph.GetEdgeCount(), ITEMS_PER_CHUNK,
+        [this, &graph](size_t first, size_t last, Base& chunk)
+        {
+            SerializeGraphEdges(graph, first, last, chunk);
+        });
+    add_slices(Chunk::GRAPH_INCIDENCE_LISTS, graph.GetVertexCount(),
+        ITEMS_PER_CHUNK, [this, &graph](size_t first, size_t last, Base& chunk)
+        {
+            SerializeGraphIncidenceLists(graph, first, last, chunk);
+        });
+    // Rows are taken from the router one by one as they are encoded, so
+    // that an updated router never holds all of them
+    for (size_t vertex = 0; vertex < graph.GetVertexCount(); ++vertex)
+    {
+        chunks.push_back({Chunk::ROUTER_ROWS, vertex, {}});
+        encoders.push_back([&router, vertex](EncodedChunk& chunk)
+            {
+                EncodePredecessorsFrom(router.LoadPredecessorsFrom(
+                    static_cast<graph::VertexId>(vertex)), chunk);
+            });
+    }
 
-    SerializeStops();
-    SerializeStopsToDistance();
-    SerializeBuses();
-    SerializeRenderSettings(render_settings);
-    SerializeRouterSettings(router_settings);
-    SerializeGraph(graph);
-    SerializeRouter(router);
+    ParallelFor(chunks.size(), [&chunks, &encoders](size_t i)
+        {
+            const trace::Span chunk_span("serialization", "EncodeChunk");
+            encoders[i](chunks[i]);
+        });
 
-    tcb_.SerializeToOstream(&ofs);
+    const trace::Span write_span("serialization", "WriteBase");
+    WriteBase(chunks, graph.GetEdgeCount(), graph.GetVertexCount());
 }
 
 void SerializationMachine::Deserialize(
     map_renderer::RenderSettingsRequest& render_settings,
     transport_router::TransportRouterSettings& router_settings,
-    graph::DirectedWeightedGraph<double>& graph,
-    graph::Router<double>& router)
+    transport_router::Graph& graph,
+    transport_router::Router& router)
 {
-    std::ifstream ifs(serialization_settings_.file_name.c_str(),
+    const trace::Span span("serialization",
+        "SerializationMachine::Deserialize");
+
+    using transport_catalogue_serialize::Chunk;
+
+    std::shared_ptr<const std::string> data;
+    {
+        const trace::Span read_span("serialization", "ReadBase");
+        data = std::make_shared<const std::string>(ReadBase());
+    }
+    transport_catalogue_serialize::BaseIndex index;
+    const std::string_view chunks_data = ParseBaseIndex(*data, index);
+
+    std::vector<Base> chunks(index.chunks_size());
+    std::vector<graph::Edge<transport_router::Weight>> edges(index.edge_count());
+    IncidenceLists incidence_lists(index.vertex_count());
+
+    ParallelFor(chunks.size(), [&](size_t i)
+        {
+            const Chunk& chunk_info = index.chunks(i);
+            if (chunk_info.section() == Chunk::ROUTER_ROWS)
+            {
+                return;
+            }
+
+            const trace::Span chunk_span("serialization", "ParseChunk");
+            chunks[i] = ParseChunk(chunk_info, chunks_data,
+                serialization_settings_.file_name);
+
+            switch (chunk_info.section())
+            {
+                case Chunk::GRAPH_EDGES:
+                    DeserializeGraphEdges(chunks[i], chunk_info.first(), edges);
+                    break;
+                case Chunk::GRAPH_INCIDENCE_LISTS:
+                    DeserializeGraphIncidenceLists(chunks[i],
+                        chunk_info.first(), incidence_lists);
+                    break;
+                default:
+                    return;
+            }
+
+            chunks[i].Clear();
+        });
+
+    {
+        const trace::Span apply_span("serialization",
+            "DeserializeCatalogueChunks");
+        for (int i = 0; i < index.chunks_size(); ++i)
+        {
+            DeserializeCatalogueChunk(index.chunks(i).section(), chunks[i],
+                render_settings, router_settings);
+        }
+    }
+
+    graph.SetEdges(edges);
+    graph.SetIncidenceLists(incidence_lists);
+    router.SetGraph(graph);
+    DeserializeRouter(data, chunks_data, index, router);
+}
+
+void SerializationMachine::WriteBase(const std::vector<EncodedChunk>& chunks,
+    size_t edge_count, size_t vertex_count) const
+{
+    transport_catalogue_serialize::BaseIndex index;
+    index.set_edge_count(edge_count);
+    index.set_vertex_count(vertex_count);
+
+    uint64_t offset = 0;
+    for (const EncodedChunk& chunk : chunks)
+    {
+        transport_catalogue_serialize::Chunk& chunk_info = *index.add_chunks();
+        chunk_info.set_section(chunk.section);
+        chunk_info.set_first(chunk.first);
+        chunk_info.set_offset(offset);
+        chunk_info.set_size(chunk.data.size());
+        chunk_info.set_raw_size(chunk.raw_size);
+        offset += chunk.data.size();
+    }
+
+    const std::string index_data = index.SerializeAsString();
+    char index_size[8];
+    for (size_t i = 0; i < sizeof(index_size); ++i)
+    {
+        index_size[i] = static_cast<char>(
+            static_cast<uint64_t>(index_data.size()) >> (8 * i));
+    }
+
+    std::ofstream ofs(serialization_settings_.file_name.c_str(),
         std::ios::binary);
-    tcb_.ParseFromIstream(&ifs);
+    ofs.write(BASE_MAGIC.data(), BASE_MAGIC.size());
+    ofs.write(index_size, sizeof(index_size));
+    ofs.write(index_data.data(), index_data.size());
+    for (const EncodedChunk& chunk : chunks)
+    {
+        ofs.write(chunk.data.data(), chunk.data.size());
+    }
+}
+
+std::string SerializationMachine::ReadBase() const
+{
+    std::ifstream ifs(serialization_settings_.file_name.c_str(),
+        std::ios::binary | std::ios::ate);
+    if (!ifs)
+    {
+        throw std::runtime_error("Unable to read base from file "
+            + serialization_settings_.file_name);
+    }
+
+    std::string data(static_cast<size_t>(ifs.tellg()), '\0');
+    ifs.seekg(0);
+    ifs.read(data.data(), data.size());
+
+    return data;
+}
+
+std::string_view SerializationMachine::ParseBaseIndex(std::string_view data,
+    transport_catalogue_serialize::BaseIndex& index) const
+{
+    const size_t header_size = BASE_MAGIC.size() + 8;
+    if (data.size() < header_size || data.substr(0, BASE_MAGIC.size())
+        != BASE_MAGIC)
+    {
+        throw std::runtime_error("Unknown base format in file "
+            + serialization_settings_.file_name);
+    }
+
+    uint64_t index_size = 0;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        index_size |= static_cast<uint64_t>(static_cast<unsigned char>(
+            data[BASE_MAGIC.size() + i])) << (8 * i);
+    }
+
+    if (index_size > data.size() - header_size
+        || !index.ParseFromArray(data.data() + header_size,
+            static_cast<int>(index_size)))
+    {
+        throw std::runtime_error("Corrupted base index in file "
+            + serialization_settings_.file_name);
+    }
 
-    DeserializeStops();
-    DeserializeStopsToDistance();
-    DeserializeBuses();
-    DeserializeRenderSettings(render_settings);
-    DeserializeRouterSettings(router_settings);
-    DeserializeGraph(graph);
-    DeserializeRouter(router, graph);
+    return data.substr(header_size + index_size);
+}
+
+SerializationMachine::Base SerializationMachine::ParseChunk(
+    const transport_catalogue_serialize::Chunk& chunk_info,
+    std::string_view chunks_data, const std::string& file_name)
+{
+    Base chunk;
+    if (chunk_info.offset() > chunks_data.size()
+        || chunk_info.size() > chunks_data.size() - chunk_info.offset()
+        || !chunk.ParseFromArray(chunks_data.data() + chunk_info.offset(),
+            static_cast<int>(chunk_info.size())))
+    {
+        throw std::runtime_error("Corrupted base chunk in file " + file_name);
+    }
+
+    return chunk;
 }
 
 transport_catalogue_serialize::Stop SerializationMachine::SerializeStop(
@@ -56,7 +333,7 @@ transport_catalogue_serialize::Stop SerializationMachine::SerializeStop(
 {
     transport_catalogue_serialize::Stop stop_proto;
 
-    stop_proto.set_name(stop.name);
+    stop_proto.set_name(stop.name.data(), stop.name.size());
     stop_proto.mutable_coords()->set_lat(stop.coords.lat);
     stop_proto.mutable_coords()->set_lng(stop.coords.lng);
     stop_proto.set_edge_id(stop.edge_id);
@@ -69,8 +346,8 @@ transport_catalogue_serialize::StopsToDistance SerializationMachine::SerializeSt
 {
     transport_catalogue_serialize::StopsToDistance stops_distance_proto;
 
-    stops_distance_proto.set_from(from->name);
-    stops_distance_proto.set_to(to->name);
+    stops_distance_proto.set_from(from->name.data(), from->name.size());
+    stops_distance_proto.set_to(to->name.data(), to->name.size());
     stops_distance_proto.set_distance(distance);
 
     return stops_distance_proto;
@@ -81,44 +358,70 @@ transport_catalogue_serialize::Bus SerializationMachine::SerializeBus(
 {
     transport_catalogue_serialize::Bus bus_proto;
 
-    bus_proto.set_name(bus.name);
+    bus_proto.set_name(bus.name.data(), bus.name.size());
     for (const auto& stop : bus.stops)
     {
-        bus_proto.add_stops(stop->name);
+        bus_proto.add_stops(stop->name.data(), stop->name.size());
     }
     bus_proto.set_is_round(bus.is_round);
+    for (const double departure : bus.departures)
+    {
+        bus_proto.add_departures(departure);
+    }
 
     return bus_proto;
 }
 
 
-void SerializationMachine::SerializeStops()
+void SerializationMachine::SerializeStops(size_t first, size_t last,
+    Base& chunk) const
 {
-    for (const domain::Stop& stop : catalogue_.GetAllStops())
+    const std::deque<domain::Stop>& stops = catalogue_.GetAllStops();
+    for (size_t i = first; i < last; ++i)
     {
-        *tcb_.add_stops() = std::move(SerializeStop(stop));
+        *chunk.add_stops() = SerializeStop(stops[i]);
     }
 }
 
-void SerializationMachine::SerializeStopsToDistance()
+void SerializationMachine::SerializeStopsToDistance(const std::vector<
+    const TransportCatalogue::StopsToDistance::value_type*>& distances,
+    size_t first, size_t last, Base& chunk) const
 {
-    for (const auto& [from_to, distance] : catalogue_.GetStopsToDistance())
+    for (size_t i = first; i < last; ++i)
     {
-        *tcb_.add_stops_to_distance() = std::move(SerializeStopsToDistanceElement(
-            from_to.first, from_to.second, distance));
+        const auto& [from_to, distance] = *distances[i];
+        *chunk.add_stops_to_distance() = SerializeStopsToDistanceElement(
+            from_to.first, from_to.second, distance);
     }
 }
 
-void SerializationMachine::SerializeBuses()
+void SerializationMachine::SerializeBuses(size_t first, size_t last,
+    Base& chunk) const
 {
-    for (const domain::Bus& bus : catalogue_.GetAllBuses())
+    const std::deque<domain::Bus>& buses = catalogue_.GetAllBuses();
+    for (size_t i = first; i < last; ++i)
     {
-        *tcb_.add_buses() = std::move(SerializeBus(bus));
+        *chunk.add_buses() = SerializeBus(buses[i]);
+    }
+}
+
+void SerializationMachine::SerializeStopBuses(size_t first, size_t last,
+    Base& chunk) const
+{
+    const std::deque<domain::Stop>& stops = catalogue_.GetAllStops();
+    for (size_t i = first; i < last; ++i)
+    {
+        auto& stop_buses_proto = *chunk.add_stop_buses();
+        for (const uint32_t bus : catalogue_.GetBusesToStop(
+            std::string(stops[i].name)))
+        {
+            stop_buses_proto.add_bus_ids(bus);
+        }
     }
 }
 
 void SerializationMachine::SerializeColor(const svg::Color& color,
-    map_renderer_serialize::Color& color_proto)
+    map_renderer_serialize::Color& color_proto) const
 {
     if (std::holds_alternative<std::monostate>(color))
     {
@@ -149,7 +452,8 @@ void SerializationMachine::SerializeColor(const svg::Color& color,
 }
 
 void SerializationMachine::SerializeRenderSettings(
-    const map_renderer::RenderSettingsRequest& render_settings)
+    const map_renderer::RenderSettingsRequest& render_settings,
+    Base& chunk) const
 {
     map_renderer_serialize::MapRenderer render_settings_proto;
 
@@ -174,18 +478,23 @@ void SerializationMachine::SerializeRenderSettings(
         SerializeColor(color, *render_settings_proto.add_color_palette());
     }
 
-    *tcb_.mutable_render_settings() = render_settings_proto;
+    *chunk.mutable_render_settings() = render_settings_proto;
 }
 
 void SerializationMachine::SerializeRouterSettings(
-    const transport_router::TransportRouterSettings& router_settings)
+    const transport_router::TransportRouterSettings& router_settings,
+    Base& chunk) const
 {
     router_serialize::RouterSettings router_settings_proto;
 
     router_settings_proto.set_bus_wait_time(router_settings.bus_wait_time);
     router_settings_proto.set_bus_velocity(router_settings.bus_velocity);
+    router_settings_proto.set_graph_model(router_settings.graph_model
+        == transport_router::GraphModel::TRANSFER
+        ? router_serialize::RouterSettings::TRANSFER
+        : router_serialize::RouterSettings::CLASSIC);
 
-    *tcb_.mutable_router_settings() = router_settings_proto;
+    *chunk.mutable_router_settings() = router_settings_proto;
 }
 
 void SerializationMachine::DeserializeStop(
@@ -199,13 +508,14 @@ void SerializationMachine::DeserializeStop(
 }
 
 graph_serialize::Edge SerializationMachine::SerializeEdge(
-    const graph::Edge<double>& edge)
+    const graph::Edge<transport_router::Weight>& edge) const
 {
     graph_serialize::Edge edge_proto;
 
     edge_proto.set_from(edge.from);
     edge_proto.set_to(edge.to);
-    edge_proto.set_weight(edge.weight);
+    edge_proto.set_weight(
+        transport_router::WeightTraits::ToMinutes(edge.weight));
     edge_proto.set_bus_name(edge.bus_name);
     edge_proto.set_span_count(edge.span_count);
 
@@ -213,7 +523,7 @@ graph_serialize::Edge SerializationMachine::SerializeEdge(
 }
 
 graph_serialize::IncidenceList SerializationMachine::SerializeIncidenceList(
-    const graph::DirectedWeightedGraph<double>::IncidentEdgesRange& incidence_list)
+    const transport_router::Graph::IncidentEdgesRange& incidence_list) const
 {
     graph_serialize::IncidenceList incidence_list_proto;
 
@@ -225,92 +535,75 @@ graph_serialize::IncidenceList SerializationMachine::SerializeIncidenceList(
     return incidence_list_proto;
 }
 
-void SerializationMachine::SerializeGraph(
-    const graph::DirectedWeightedGraph<double>& graph)
+void SerializationMachine::SerializeGraphEdges(
+    const transport_router::Graph& graph,
+    size_t first, size_t last, Base& chunk) const
 {
-    graph_serialize::Graph graph_proto;
+    graph_serialize::Graph& graph_proto = *chunk.mutable_graph();
 
-    for (int i = 0; i < graph.GetEdgeCount(); ++i)
+    for (size_t i = first; i < last; ++i)
     {
         *graph_proto.add_edges() = SerializeEdge(graph.GetEdge(i));
     }
-
-    for (int i = 0; i < graph.GetVertexCount(); ++i)
-    {
-        *graph_proto.add_incidence_list() = SerializeIncidenceList(
-            graph.GetIncidentEdges(i));
-    }
-
-    *tcb_.mutable_graph() = graph_proto;
 }
 
-router_serialize::RID SerializationMachine::SerializeRID(
-    const graph::Router<double>::RouteInternalData& rid)
+void SerializationMachine::SerializeGraphIncidenceLists(
+    const transport_router::Graph& graph,
+    size_t first, size_t last, Base& chunk) const
 {
-    router_serialize::RID rid_proto;
+    graph_serialize::Graph& graph_proto = *chunk.mutable_graph();
 
-    rid_proto.set_weight(rid.weight);
-    
-    if (rid.prev_edge.has_value())
-    {
-        rid_proto.set_prev_edge(*(rid.prev_edge));
-        rid_proto.set_prev_edge_is_set(true);
-    }
-    else
+    for (size_t i = first; i < last; ++i)
     {
-        rid_proto.set_prev_edge_is_set(false);
+        *graph_proto.add_incidence_list() = SerializeIncidenceList(
+            graph.GetIncidentEdges(i));
     }
-
-    return rid_proto;
 }
 
-router_serialize::OptionalRID SerializationMachine::SerializeOptionalRID(
-    const std::optional<graph::Router<double>::RouteInternalData>&
-    optional_rid)
+router_serialize::CompactRow SerializationMachine::SerializeCompactRow(
+    const PredecessorsFrom& predecessors)
 {
-    router_serialize::OptionalRID optional_rid_proto;
-
-    if (optional_rid.has_value())
-    {
-        *optional_rid_proto.mutable_rid() = SerializeRID(*optional_rid);
-        optional_rid_proto.set_rid_is_set(true);
-    }
-    else
-    {
-        optional_rid_proto.set_rid_is_set(false);
-    }
+    using Router = transport_router::Router;
 
-    return optional_rid_proto;
-}
+    router_serialize::CompactRow row_proto;
+    std::string reachable((predecessors.size() + 7) / 8, '\0');
 
-router_serialize::RepeatedRID SerializationMachine::SerializeRepeatedRID(
-    const std::vector<std::optional<graph::Router<double>::RouteInternalData>>&
-    repeated_rid)
-{
-    router_serialize::RepeatedRID repeated_rid_proto;
-
-    for (const auto& optional_rid : repeated_rid)
+    int64_t previous_edge = 0;
+    for (size_t vertex = 0; vertex < predecessors.size(); ++vertex)
     {
-        *repeated_rid_proto.add_optional_rid() =
-            SerializeOptionalRID(optional_rid);
+        const uint32_t edge_id = predecessors[vertex];
+        if (edge_id == Router::NO_ROUTE)
+        {
+            continue;
+        }
+
+        reachable[vertex / 8] |= static_cast<char>(1 << (vertex % 8));
+
+        const int64_t edge = edge_id == Router::NO_EDGE
+            ? 0 : static_cast<int64_t>(edge_id) + 1;
+        row_proto.add_prev_edges(edge - previous_edge);
+        previous_edge = edge;
     }
+    row_proto.set_reachable(std::move(reachable));
 
-    return repeated_rid_proto;
+    return row_proto;
 }
 
-void SerializationMachine::SerializeRouter(const graph::Router<double>& router)
+void SerializationMachine::EncodePredecessorsFrom(
+    const PredecessorsFrom& predecessors, EncodedChunk& chunk)
 {
-    router_serialize::RepeatedRIDs repeated_rids_proto;    
-    const graph::Router<double>::RoutesInternalData& repeated_rids =
-        router.GetRIDs();
-    
-    for (const auto& repeated_rid : repeated_rids)
+    const std::string raw = SerializeCompactRow(predecessors).SerializeAsString();
+
+    uLongf compressed_size = compressBound(raw.size());
+    chunk.data.resize(compressed_size);
+    if (compress2(reinterpret_cast<Bytef*>(chunk.data.data()), &compressed_size,
+        reinterpret_cast<const Bytef*>(raw.data()), raw.size(), Z_BEST_SPEED)
+        != Z_OK)
     {
-        *repeated_rids_proto.add_rids() =
-            SerializeRepeatedRID(repeated_rid);
+        throw std::runtime_error("Unable to compress router row");
     }
-
-    *tcb_.mutable_router_rid() = repeated_rids_proto;
+    chunk.data.resize(compressed_size);
+    chunk.raw_size = raw.size();
 }
 
 void SerializationMachine::DeserializeStopsToDistanceElement(
@@ -323,41 +616,63 @@ void SerializationMachine::DeserializeStopsToDistanceElement(
 void SerializationMachine::DeserializeBus(
     const transport_catalogue_serialize::Bus& bus)
 {
-    std::vector<std::string> stops_temp;
-    for (int i = 0; i < bus.stops_size(); ++i)
+    const std::vector<std::string_view> stops_temp(bus.stops().begin(),
+        bus.stops().end());
+
+    catalogue_.AddBus(bus.name(), stops_temp, bus.is_round());
+
+    if (bus.departures_size() > 0)
     {
-        stops_temp.push_back(bus.stops(i));
+        catalogue_.AddDepartures(bus.name(), {bus.departures().begin(),
+            bus.departures().end()});
     }
+}
 
-    catalogue_.AddBus(bus.name(), stops_temp, bus.is_round());
+void SerializationMachine::DeserializeStops(const Base& chunk)
+{
+    for (int i = 0; i < chunk.stops_size(); ++i)
+    {
+        DeserializeStop(chunk.stops(i));
+    }
 }
 
-void SerializationMachine::DeserializeStops()
+void SerializationMachine::DeserializeStopsToDistance(const Base& chunk)
 {
-    for (int i = 0; i < tcb_.stops_size(); ++i)
+    for (int i = 0; i < chunk.stops_to_distance_size(); ++i)
     {
-        DeserializeStop(tcb_.stops(i));
+        DeserializeStopsToDistanceElement(chunk.stops_to_distance(i));
     }
 }
 
-void SerializationMachine::DeserializeStopsToDistance()
+void SerializationMachine::DeserializeBuses(const Base& chunk)
 {
-    for (int i = 0; i < tcb_.stops_to_distance_size(); ++i)
+    for (int i = 0; i < chunk.buses_size(); ++i)
     {
-        DeserializeStopsToDistanceElement(tcb_.stops_to_distance(i));
+        DeserializeBus(chunk.buses(i));
     }
 }
 
-void SerializationMachine::DeserializeBuses()
+void SerializationMachine::DeserializeStopBuses(const Base& chunk)
 {
-    for (int i = 0; i < tcb_.buses_size(); ++i)
+    const size_t bus_count = catalogue_.GetAllBuses().size();
+    for (const auto& stop_buses : chunk.stop_buses())
     {
-        DeserializeBus(tcb_.buses(i));
+        for (const uint32_t bus : stop_buses.bus_ids())
+        {
+            if (bus >= bus_count)
+            {
+                throw std::runtime_error("Corrupted buses of stops in base file "
+                    + serialization_settings_.file_name);
+            }
+        }
+
+        catalogue_.AddStopBuses({stop_buses.bus_ids().begin(),
+            stop_buses.bus_ids().end()});
     }
 }
 
 svg::Color SerializationMachine::DeserializeColor(
-    const map_renderer_serialize::Color& color_proto)
+    const map_renderer_serialize::Color& color_proto) const
 {
     const auto& rgba_proto = color_proto.rgba();
     const auto& rgb_proto = color_proto.rgb();
@@ -378,10 +693,10 @@ svg::Color SerializationMachine::DeserializeColor(
     return std::monostate{};
 }
 
-void SerializationMachine::DeserializeRenderSettings(
-    map_renderer::RenderSettingsRequest& render_settings)
+void SerializationMachine::DeserializeRenderSettings(const Base& chunk,
+    map_renderer::RenderSettingsRequest& render_settings) const
 {
-    auto& rs_proto = *tcb_.mutable_render_settings();
+    const auto& rs_proto = chunk.render_settings();
 
     render_settings.width = rs_proto.width();
     render_settings.height = rs_proto.height();
@@ -404,34 +719,68 @@ void SerializationMachine::DeserializeRenderSettings(
     }
 }
 
-void SerializationMachine::DeserializeRouterSettings(
-    transport_router::TransportRouterSettings& router_settings)
+void SerializationMachine::DeserializeRouterSettings(const Base& chunk,
+    transport_router::TransportRouterSettings& router_settings) const
 {
-    auto& rs_proto = *tcb_.mutable_router_settings();
+    const auto& rs_proto = chunk.router_settings();
 
     router_settings.bus_wait_time = rs_proto.bus_wait_time();
     router_settings.bus_velocity = rs_proto.bus_velocity();
+    router_settings.graph_model = rs_proto.graph_model()
+        == router_serialize::RouterSettings::TRANSFER
+        ? transport_router::GraphModel::TRANSFER
+        : transport_router::GraphModel::CLASSIC;
+}
+
+void SerializationMachine::DeserializeCatalogueChunk(Section section,
+    const Base& chunk, map_renderer::RenderSettingsRequest& render_settings,
+    transport_router::TransportRouterSettings& router_settings)
+{
+    using transport_catalogue_serialize::Chunk;
+
+    switch (section)
+    {
+        case Chunk::STOPS:
+            DeserializeStops(chunk);
+            break;
+        case Chunk::STOPS_TO_DISTANCE:
+            DeserializeStopsToDistance(chunk);
+            break;
+        case Chunk::BUSES:
+            DeserializeBuses(chunk);
+            break;
+        case Chunk::STOP_BUSES:
+            DeserializeStopBuses(chunk);
+            break;
+        case Chunk::SETTINGS:
+            DeserializeRenderSettings(chunk, render_settings);
+            DeserializeRouterSettings(chunk, router_settings);
+            break;
+        default:
+            break;
+    }
 }
 
-graph::Edge<double> SerializationMachine::DeserializeEdge(
-    const graph_serialize::Edge edge_proto)
+graph::Edge<transport_router::Weight> SerializationMachine::DeserializeEdge(
+    const graph_serialize::Edge& edge_proto) const
 {
-    graph::Edge<double> edge;
+    graph::Edge<transport_router::Weight> edge;
 
     edge.from = edge_proto.from();
     edge.to = edge_proto.to();
-    edge.weight = edge_proto.weight();
+    edge.weight = transport_router::WeightTraits::FromMinutes(
+        edge_proto.weight());
     edge.bus_name = edge_proto.bus_name();
     edge.span_count = edge_proto.span_count();
 
     return edge;
 }
 
-graph::DirectedWeightedGraph<double>::IncidenceList
+transport_router::Graph::IncidenceList
 SerializationMachine::DeserializeIncedenceList(
-    const graph_serialize::IncidenceList incedence_list_proto)
+    const graph_serialize::IncidenceList& incedence_list_proto) const
 {
-    graph::DirectedWeightedGraph<double>::IncidenceList incedence_list;
+    transport_router::Graph::IncidenceList incedence_list;
 
     for (const auto& edge_id : incedence_list_proto.edge_id())
     {
@@ -441,79 +790,138 @@ SerializationMachine::DeserializeIncedenceList(
     return incedence_list;
 }
 
-void SerializationMachine::DeserializeGraph(
-    graph::DirectedWeightedGraph<double>& graph)
+void SerializationMachine::DeserializeGraphEdges(const Base& chunk,
+    size_t first, std::vector<graph::Edge<transport_router::Weight>>& edges) const
 {
-    std::vector<graph::Edge<double>> edges;
-    for (const auto& edge : tcb_.mutable_graph()->edges())
+    const auto& edges_proto = chunk.graph().edges();
+    if (first > edges.size()
+        || static_cast<size_t>(edges_proto.size()) > edges.size() - first)
     {
-        edges.push_back(DeserializeEdge(edge));
+        throw std::runtime_error("Corrupted graph edges in base file "
+            + serialization_settings_.file_name);
     }
-    graph.SetEdges(edges);
 
-    std::vector<graph::DirectedWeightedGraph<double>::IncidenceList> incedence_lists;
-    for (const auto& incedence_list : tcb_.mutable_graph()->incidence_list())
+    for (const auto& edge : edges_proto)
     {
-        incedence_lists.push_back(DeserializeIncedenceList(incedence_list));
+        edges[first++] = DeserializeEdge(edge);
     }
-    graph.SetIncidenceLists(incedence_lists);
 }
 
-graph::Router<double>::RouteInternalData
-SerializationMachine::DeserializeRID(const router_serialize::RID& rid_proto)
+void SerializationMachine::DeserializeGraphIncidenceLists(const Base& chunk,
+    size_t first, IncidenceLists& incidence_lists) const
 {
-    graph::Router<double>::RouteInternalData rid;
-    rid.weight = rid_proto.weight();
-    if (rid_proto.prev_edge_is_set())
+    const auto& lists_proto = chunk.graph().incidence_list();
+    if (first > incidence_lists.size() || static_cast<size_t>(
+        lists_proto.size()) > incidence_lists.size() - first)
     {
-        rid.prev_edge = rid_proto.prev_edge();
-        return rid;
+        throw std::runtime_error("Corrupted graph incidence lists in base file "
+            + serialization_settings_.file_name);
     }
 
-    rid.prev_edge = std::nullopt;
-    return rid;
+    for (const auto& incedence_list : lists_proto)
+    {
+        incidence_lists[first++] = DeserializeIncedenceList(incedence_list);
+    }
 }
 
-std::optional<graph::Router<double>::RouteInternalData>
-SerializationMachine::DeserializeOptionalRID(
-    const router_serialize::OptionalRID& optional_rid_proto)
+SerializationMachine::PredecessorsFrom
+SerializationMachine::DeserializeCompactRow(
+    const router_serialize::CompactRow& row_proto, size_t vertex_count)
 {
-    std::optional<graph::Router<double>::RouteInternalData> optional_rid;
-    if (optional_rid_proto.rid_is_set())
+    using Router = transport_router::Router;
+
+    const std::string& reachable = row_proto.reachable();
+    if (reachable.size() != (vertex_count + 7) / 8)
     {
-        optional_rid = DeserializeRID(optional_rid_proto.rid());
+        throw std::runtime_error("Corrupted router row");
+    }
 
-        return optional_rid;
+    PredecessorsFrom predecessors(vertex_count, Router::NO_ROUTE);
+    int cell = 0;
+    int64_t edge = 0;
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex)
+    {
+        if (!(reachable[vertex / 8] & (1 << (vertex % 8))))
+        {
+            continue;
+        }
+
+        if (cell == row_proto.prev_edges_size())
+        {
+            throw std::runtime_error("Corrupted router row");
+        }
+
+        edge += row_proto.prev_edges(cell++);
+        if (edge < 0 || edge > Router::NO_EDGE)
+        {
+            throw std::runtime_error("Corrupted router row");
+        }
+        predecessors[vertex] = edge > 0 ? static_cast<uint32_t>(edge - 1)
+            : Router::NO_EDGE;
     }
 
-    optional_rid = std::nullopt;
-    return optional_rid;
+    return predecessors;
 }
 
-std::vector<std::optional<graph::Router<double>::RouteInternalData>>
-SerializationMachine::DeserializeRepeatedRID(
-    const router_serialize::RepeatedRID& repeated_rid_proto)
+SerializationMachine::PredecessorsFrom
+SerializationMachine::DecodePredecessorsFrom(
+    const transport_catalogue_serialize::Chunk& chunk_info,
+    std::string_view chunks_data, size_t vertex_count,
+    const std::string& file_name)
 {
-    std::vector<std::optional<graph::Router<double>::RouteInternalData>> repeated_rid;
-    for (const auto& optional_rid : repeated_rid_proto.optional_rid())
+    if (chunk_info.offset() > chunks_data.size()
+        || chunk_info.size() > chunks_data.size() - chunk_info.offset())
+    {
+        throw std::runtime_error("Corrupted router rows in base file "
+            + file_name);
+    }
+
+    std::string raw(chunk_info.raw_size(), '\0');
+    uLongf raw_size = raw.size();
+    router_serialize::CompactRow row_proto;
+    if (uncompress(reinterpret_cast<Bytef*>(raw.data()), &raw_size,
+        reinterpret_cast<const Bytef*>(chunks_data.data() + chunk_info.offset()),
+        chunk_info.size()) != Z_OK
+        || raw_size != raw.size()
+        || !row_proto.ParseFromString(raw))
     {
-        repeated_rid.push_back(DeserializeOptionalRID(optional_rid));
+        throw std::runtime_error("Corrupted router rows in base file "
+            + file_name);
     }
 
-    return repeated_rid;
+    return DeserializeCompactRow(row_proto, vertex_count);
 }
 
-void SerializationMachine::DeserializeRouter(graph::Router<double>& router,
-    const graph::DirectedWeightedGraph<double>& graph)
+void SerializationMachine::DeserializeRouter(
+    const std::shared_ptr<const std::string>& data, std::string_view chunks_data,
+    const transport_catalogue_serialize::BaseIndex& index,
+    transport_router::Router& router) const
 {
-    graph::Router<double>::RoutesInternalData routes_internal_data;
-    for (const auto& rid : tcb_.mutable_router_rid()->rids())
+    using transport_catalogue_serialize::Chunk;
+
+    std::vector<Chunk> rows(index.vertex_count());
+    for (const Chunk& chunk_info : index.chunks())
     {
-        routes_internal_data.push_back(DeserializeRepeatedRID(rid));
+        if (chunk_info.section() == Chunk::ROUTER_ROWS)
+        {
+            if (chunk_info.first() >= rows.size())
+            {
+                throw std::runtime_error("Corrupted router rows in base file "
+                    + serialization_settings_.file_name);
+            }
+            rows[chunk_info.first()] = chunk_info;
+        }
     }
 
-    router.SetRIDs(routes_internal_data);
-    router.SetGraph(graph);
+    // The loader owns the file contents, chunks_data points into them
+    const size_t vertex_count = rows.size();
+    router.SetPredecessorsLoader(vertex_count, [data, chunks_data,
+        rows = std::move(rows), file_name = serialization_settings_.file_name](
+        graph::VertexId vertex_from)
+        {
+            return DecodePredecessorsFrom(rows[vertex_from], chunks_data,
+                rows.size(), file_name);
+        }, serialization_settings_.router_cache_size);
 }
 
 }
@@ -5,15 +5,28 @@
 #include "map_renderer.h"
 #include "router.h"
 #include "svg.h"
+#include "trace.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
 #include <transport_catalogue.pb.h>
 #include <map_renderer.pb.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -23,28 +36,64 @@ namespace serialization {
 
 struct SerializationSettings {
     std::string file_name;
+    // Memory budget for routing rows decoded on demand
+    size_t router_cache_size = size_t{256} << 20;
 };
 
 class SerializationMachine {
 public:
     SerializationMachine(TransportCatalogue& catalogue);
 
-    void SetSettings(const std::string& file_name);
+    void SetSettings(const SerializationSettings& settings);
+
+    const SerializationSettings& GetSettings() const;
     
+    // Writes the base as independent chunks encoded on all hardware threads
     void Serialize(const map_renderer::RenderSettingsRequest& render_settings,
         const transport_router::TransportRouterSettings& router_settings,
-        const graph::DirectedWeightedGraph<double>& graph,
-        const graph::Router<double>& router);
+        const transport_router::Graph& graph,
+        const transport_router::Router& router);
 
+    // Decodes chunks of the base in parallel, then applies catalogue
+    // sections in order. Router rows are left encoded and decoded by the
+    // router the first time a route from their vertex is asked for
     void Deserialize(map_renderer::RenderSettingsRequest& render_settings,
         transport_router::TransportRouterSettings& router_settings,
-        graph::DirectedWeightedGraph<double>& graph,
-        graph::Router<double>& router);
+        transport_router::Graph& graph,
+        transport_router::Router& router);
 
 private:
+    using Base = transport_catalogue_serialize::TransportCatalogueBase;
+    using Section = transport_catalogue_serialize::Chunk::Section;
+    using PredecessorsFrom = transport_router::Router::PredecessorsFrom;
+    using IncidenceLists =
+        std::vector<transport_router::Graph::IncidenceList>;
+
+    struct EncodedChunk {
+        Section section;
+        size_t first = 0;
+        std::string data;
+        // Size before compression, 0 when the data is not compressed
+        size_t raw_size = 0;
+    };
+
+    static constexpr std::string_view BASE_MAGIC = "TCBASE04";
+    static constexpr size_t ITEMS_PER_CHUNK = 4096;
+
     SerializationSettings serialization_settings_;
     TransportCatalogue& catalogue_; 
-    transport_catalogue_serialize::TransportCatalogueBase tcb_;
+
+    void WriteBase(const std::vector<EncodedChunk>& chunks,
+        size_t edge_count, size_t vertex_count) const;
+
+    std::string ReadBase() const;
+
+    std::string_view ParseBaseIndex(std::string_view data,
+        transport_catalogue_serialize::BaseIndex& index) const;
+
+    static Base ParseChunk(
+        const transport_catalogue_serialize::Chunk& chunk_info,
+        std::string_view chunks_data, const std::string& file_name);
 
     transport_catalogue_serialize::Stop SerializeStop(
         const domain::Stop& stop) const;
@@ -55,38 +104,44 @@ private:
     transport_catalogue_serialize::Bus SerializeBus(
         const domain::Bus& bus) const;
 
-    void SerializeStops();
+    void SerializeStops(size_t first, size_t last, Base& chunk) const;
 
-    void SerializeStopsToDistance();
+    void SerializeStopsToDistance(const std::vector<
+        const TransportCatalogue::StopsToDistance::value_type*>& distances,
+        size_t first, size_t last, Base& chunk) const;
 
-    void SerializeBuses();
+    void SerializeBuses(size_t first, size_t last, Base& chunk) const;
+
+    void SerializeStopBuses(size_t first, size_t last, Base& chunk) const;
 
     void SerializeColor(const svg::Color& color,
-        map_renderer_serialize::Color& color_proto);
+        map_renderer_serialize::Color& color_proto) const;
 
     void SerializeRenderSettings(
-        const map_renderer::RenderSettingsRequest& render_settings);
+        const map_renderer::RenderSettingsRequest& render_settings,
+        Base& chunk) const;
 
     void SerializeRouterSettings(
-        const transport_router::TransportRouterSettings& router_settings);
+        const transport_router::TransportRouterSettings& router_settings,
+        Base& chunk) const;
     
     graph_serialize::IncidenceList SerializeIncidenceList(
-        const graph::DirectedWeightedGraph<double>::IncidentEdgesRange& incidence_list);
+        const transport_router::Graph::IncidentEdgesRange& incidence_list) const;
 
-    graph_serialize::Edge SerializeEdge(const graph::Edge<double>& edge);
+    graph_serialize::Edge SerializeEdge(const graph::Edge<transport_router::Weight>& edge) const;
 
-    void SerializeGraph(const graph::DirectedWeightedGraph<double>& graph);
+    void SerializeGraphEdges(const transport_router::Graph& graph,
+        size_t first, size_t last, Base& chunk) const;
 
-    router_serialize::RID SerializeRID(
-        const graph::Router<double>::RouteInternalData& rid);
-    
-    router_serialize::OptionalRID SerializeOptionalRID(const std::optional<
-        graph::Router<double>::RouteInternalData>& optional_rid);
+    void SerializeGraphIncidenceLists(
+        const transport_router::Graph& graph,
+        size_t first, size_t last, Base& chunk) const;
 
-    router_serialize::RepeatedRID SerializeRepeatedRID(const std::vector<
-        std::optional<graph::Router<double>::RouteInternalData>>& repeated_rid);
+    static router_serialize::CompactRow SerializeCompactRow(
+        const PredecessorsFrom& predecessors);
 
-    void SerializeRouter(const graph::Router<double>& router);
+    static void EncodePredecessorsFrom(const PredecessorsFrom& predecessors,
+        EncodedChunk& chunk);
 
     void DeserializeStop(const transport_catalogue_serialize::Stop& stop);
 
@@ -95,41 +150,54 @@ private:
 
     void DeserializeBus(const transport_catalogue_serialize::Bus& bus);
 
-    void DeserializeStops();
+    void DeserializeStops(const Base& chunk);
 
-    void DeserializeStopsToDistance();
+    void DeserializeStopsToDistance(const Base& chunk);
 
-    void DeserializeBuses();
+    void DeserializeBuses(const Base& chunk);
+
+    void DeserializeStopBuses(const Base& chunk);
 
     svg::Color DeserializeColor(
-        const map_renderer_serialize::Color& color_proto);
+        const map_renderer_serialize::Color& color_proto) const;
+
+    void DeserializeRenderSettings(const Base& chunk,
+        map_renderer::RenderSettingsRequest& render_settings) const;
 
-    void DeserializeRenderSettings(
-        map_renderer::RenderSettingsRequest& render_settings);
+    void DeserializeRouterSettings(const Base& chunk,
+        transport_router::TransportRouterSettings& router_settings) const;
 
-    void DeserializeRouterSettings(
+    // Applies a chunk of catalogue and settings sections, which have to be
+    // applied one by one in the order of the index
+    void DeserializeCatalogueChunk(Section section, const Base& chunk,
+        map_renderer::RenderSettingsRequest& render_settings,
         transport_router::TransportRouterSettings& router_settings);
     
-    graph::DirectedWeightedGraph<double>::IncidenceList DeserializeIncedenceList(
-        const graph_serialize::IncidenceList incedence_list_proto);
+    transport_router::Graph::IncidenceList DeserializeIncedenceList(
+        const graph_serialize::IncidenceList& incedence_list_proto) const;
 
-    graph::Edge<double> DeserializeEdge(const graph_serialize::Edge edge_proto);
+    graph::Edge<transport_router::Weight> DeserializeEdge(
+        const graph_serialize::Edge& edge_proto) const;
 
-    void DeserializeGraph(graph::DirectedWeightedGraph<double>& graph);
+    void DeserializeGraphEdges(const Base& chunk, size_t first,
+        std::vector<graph::Edge<transport_router::Weight>>& edges) const;
 
-    graph::Router<double>::RouteInternalData DeserializeRID(
-        const router_serialize::RID& rid_proto);
+    void DeserializeGraphIncidenceLists(const Base& chunk, size_t first,
+        IncidenceLists& incidence_lists) const;
 
-    std::optional<graph::Router<double>::RouteInternalData>
-    DeserializeOptionalRID(
-        const router_serialize::OptionalRID& optional_rid_proto);
+    static PredecessorsFrom DeserializeCompactRow(
+        const router_serialize::CompactRow& row_proto, size_t vertex_count);
 
-    std::vector<std::optional<graph::Router<double>::RouteInternalData>>
-    DeserializeRepeatedRID(
-        const router_serialize::RepeatedRID& repeated_rid_proto);
+    static PredecessorsFrom DecodePredecessorsFrom(
+        const transport_catalogue_serialize::Chunk& chunk_info,
+        std::string_view chunks_data, size_t vertex_count,
+        const std::string& file_name);
 
-    void DeserializeRouter(graph::Router<double>& router,
-        const graph::DirectedWeightedGraph<double>& graph);
+    void DeserializeRouter(
+        const std::shared_ptr<const std::string>& data,
+        std::string_view chunks_data,
+        const transport_catalogue_serialize::BaseIndex& index,
+        transport_router::Router& router) const;
 };
 
 }
@@ -0,0 +1,170 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std::literals;
+
+namespace stats {
+
+namespace {
+
+const double BYTES_IN_MB = 1024.0 * 1024.0;
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+void LatencyHistogram::Add(double milliseconds)
+{
+    const double microseconds = std::max(milliseconds * 1000.0, 1.0);
+    const size_t bucket = std::min(static_cast<size_t>(
+        std::log2(microseconds) * SUB_BUCKETS), BUCKETS_COUNT - 1);
+
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_microseconds_.fetch_add(static_cast<uint64_t>(microseconds),
+        std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetTotal() const
+{
+    return total_microseconds_.load(std::memory_order_relaxed) / 1000.0;
+}
+
+double LatencyHistogram::GetPercentile(double percentile) const
+{
+    const uint64_t count = GetCount();
+    if (count == 0)
+    {
+        return 0.0;
+    }
+
+    const uint64_t rank = static_cast<uint64_t>(
+        std::ceil(percentile / 100.0 * count));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS_COUNT; ++bucket)
+    {
+        seen += buckets_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+
+    return GetBucketUpperBound(BUCKETS_COUNT - 1);
+}
+
+double LatencyHistogram::GetBucketUpperBound(size_t bucket)
+{
+    return std::exp2(static_cast<double>(bucket + 1) / SUB_BUCKETS) / 1000.0;
+}
+
+size_t GetPeakMemoryUsage()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void Stats::AddPhase(std::string name, double milliseconds)
+{
+    const size_t peak_memory = GetPeakMemoryUsage();
+
+    std::lock_guard lock(mutex_);
+    phases_.push_back({std::move(name), milliseconds, peak_memory});
+}
+
+void Stats::AddRequest(std::string_view type, double milliseconds)
+{
+    LatencyHistogram* histogram = nullptr;
+    {
+        std::lock_guard lock(mutex_);
+        auto it = requests_.find(type);
+        if (it == requests_.end())
+        {
+            it = requests_.try_emplace(std::string(type)).first;
+        }
+        histogram = &it->second;
+    }
+
+    histogram->Add(milliseconds);
+}
+
+json::Node Stats::BuildReport() const
+{
+    std::lock_guard lock(mutex_);
+
+    json::Array phases;
+    for (const Phase& phase : phases_)
+    {
+        phases.push_back(json::Builder{}.StartDict()
+            .Key("name"s).Value(phase.name)
+            .Key("ms"s).Value(phase.milliseconds)
+            .Key("peak_memory_mb"s).Value(phase.peak_memory / BYTES_IN_MB)
+            .EndDict().Build());
+    }
+
+    json::Dict requests;
+    for (const auto& [type, histogram] : requests_)
+    {
+        requests[type] = json::Builder{}.StartDict()
+            .Key("count"s).Value(static_cast<int>(histogram.GetCount()))
+            .Key("total_ms"s).Value(histogram.GetTotal())
+            .Key("p50_ms"s).Value(histogram.GetPercentile(50.0))
+            .Key("p90_ms"s).Value(histogram.GetPercentile(90.0))
+            .Key("p99_ms"s).Value(histogram.GetPercentile(99.0))
+            .Key("max_ms"s).Value(histogram.GetPercentile(100.0))
+            .EndDict().Build();
+    }
+
+    return json::Builder{}.StartDict()
+        .Key("phases"s).Value(std::move(phases))
+        .Key("requests"s).Value(std::move(requests))
+        .Key("peak_memory_mb"s).Value(GetPeakMemoryUsage() / BYTES_IN_MB)
+        .EndDict().Build();
+}
+
+ScopedTimer::ScopedTimer(Stats* stats, std::string name)
+    : stats_(stats)
+    , name_(stats ? std::move(name) : std::string{})
+{
+    if (stats_)
+    {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (stats_)
+    {
+        stats_->AddPhase(std::move(name_), ElapsedMilliseconds(start_));
+    }
+}
+
+}  // namespace stats
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "json.h"
+#include "json_builder.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace stats {
+
+// Lock-free log-linear latency histogram: every power of two of
+// microseconds is split into SUB_BUCKETS equal buckets
+class LatencyHistogram {
+public:
+    void Add(double milliseconds);
+
+    uint64_t GetCount() const;
+
+    double GetTotal() const;
+
+    // Upper bound of the bucket holding the given percentile, in ms
+    double GetPercentile(double percentile) const;
+
+private:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKETS_COUNT = 40 * SUB_BUCKETS;
+
+    std::array<std::atomic<uint64_t>, BUCKETS_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_microseconds_{0};
+
+    static double GetBucketUpperBound(size_t bucket);
+};
+
+// Peak resident set size of the process in bytes, 0 where unknown
+size_t GetPeakMemoryUsage();
+
+// Wall time of program phases and latencies of stat requests by type.
+// May be filled from several threads at once
+class Stats {
+public:
+    void AddPhase(std::string name, double milliseconds);
+
+    void AddRequest(std::string_view type, double milliseconds);
+
+    json::Node BuildReport() const;
+
+private:
+    struct Phase {
+        std::string name;
+        double milliseconds = 0.0;
+        // Peak memory usage of the process when the phase ended
+        size_t peak_memory = 0;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Phase> phases_;
+    std::map<std::string, LatencyHistogram, std::less<>> requests_;
+};
+
+// Adds the time from its construction to destruction to stats as a phase.
+// Does nothing without stats, so instrumented code costs nothing unless
+// the report was asked for
+class ScopedTimer {
+public:
+    ScopedTimer(Stats* stats, std::string name);
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer();
+
+private:
+    Stats* stats_;
+    std::string name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace stats
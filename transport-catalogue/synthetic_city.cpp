@@ -0,0 +1,314 @@
+#include "synthetic_city.h"
+
+using namespace std::literals;
+
+namespace synthetic_city {
+
+namespace {
+
+const double START_LAT = 55.55;
+const double START_LNG = 37.35;
+const double GRID_STEP = 0.004;
+const double GRID_JITTER = 0.6;
+
+const double MIN_ROAD_FACTOR = 1.1;
+const double ROAD_FACTOR_SPREAD = 0.5;
+
+}  // namespace
+
+CityGenerator::CityGenerator(const CitySettings& settings)
+    : settings_(settings)
+{
+    if (settings_.stop_count < 2 || settings_.bus_count == 0
+        || settings_.route_length < 2)
+    {
+        throw std::invalid_argument(
+            "City needs at least two stops and a bus with two stops");
+    }
+
+    grid_side_ = static_cast<size_t>(
+        std::ceil(std::sqrt(static_cast<double>(settings_.stop_count))));
+}
+
+json::Node CityGenerator::MakeBaseRequests(const std::string& base_file)
+{
+    Reseed(0);
+
+    std::vector<geo::Coordinates> coords;
+    coords.reserve(settings_.stop_count);
+    for (size_t stop = 0; stop < settings_.stop_count; ++stop)
+    {
+        const double row = static_cast<double>(stop / grid_side_)
+            + GRID_JITTER * (NextUnit() - 0.5);
+        const double column = static_cast<double>(stop % grid_side_)
+            + GRID_JITTER * (NextUnit() - 0.5);
+        coords.push_back({START_LAT + row * GRID_STEP,
+            START_LNG + column * GRID_STEP});
+    }
+
+    std::vector<std::map<size_t, int>> road_distances(settings_.stop_count);
+    auto add_road_distance = [this, &coords, &road_distances](size_t from,
+        size_t to)
+    {
+        if (road_distances[from].count(to))
+        {
+            return;
+        }
+        const double factor = MIN_ROAD_FACTOR
+            + ROAD_FACTOR_SPREAD * NextUnit();
+        road_distances[from][to] = static_cast<int>(std::ceil(
+            geo::ComputeDistance(coords[from], coords[to]) * factor));
+    };
+
+    json::Array bus_requests;
+    bus_requests.reserve(settings_.bus_count);
+    for (size_t bus = 0; bus < settings_.bus_count; ++bus)
+    {
+        const std::vector<size_t> stops = MakeWalk();
+        const bool is_roundtrip = NextIndex(5) < 2;
+
+        json::Array stop_names;
+        for (size_t i = 0; i < stops.size(); ++i)
+        {
+            stop_names.push_back(GetStopName(stops[i]));
+            if (i + 1 < stops.size())
+            {
+                add_road_distance(stops[i], stops[i + 1]);
+                // Roads back are mostly the same, which the catalogue
+                // assumes when only one direction is given
+                if (NextIndex(4) == 0)
+                {
+                    add_road_distance(stops[i + 1], stops[i]);
+                }
+            }
+        }
+        if (is_roundtrip)
+        {
+            add_road_distance(stops.back(), stops.front());
+            stop_names.push_back(GetStopName(stops.front()));
+        }
+
+        bus_requests.push_back(json::Builder{}.StartDict()
+            .Key("type"s).Value("Bus"s)
+            .Key("name"s).Value(GetBusName(bus))
+            .Key("stops"s).Value(std::move(stop_names))
+            .Key("is_roundtrip"s).Value(is_roundtrip)
+            .EndDict().Build());
+    }
+
+    json::Array base_requests;
+    base_requests.reserve(settings_.stop_count + settings_.bus_count);
+    for (size_t stop = 0; stop < settings_.stop_count; ++stop)
+    {
+        json::Dict distances;
+        for (const auto& [stop_to, distance] : road_distances[stop])
+        {
+            distances.emplace(GetStopName(stop_to), distance);
+        }
+
+        base_requests.push_back(json::Builder{}.StartDict()
+            .Key("type"s).Value("Stop"s)
+            .Key("name"s).Value(GetStopName(stop))
+            .Key("latitude"s).Value(coords[stop].lat)
+            .Key("longitude"s).Value(coords[stop].lng)
+            .Key("road_distances"s).Value(std::move(distances))
+            .EndDict().Build());
+    }
+    std::move(bus_requests.begin(), bus_requests.end(),
+        std::back_inserter(base_requests));
+
+    return json::Builder{}.StartDict()
+        .Key("serialization_settings"s)
+        .Value(MakeSerializationSettings(base_file))
+        .Key("routing_settings"s).Value(MakeRoutingSettings())
+        .Key("render_settings"s).Value(MakeRenderSettings())
+        .Key("base_requests"s).Value(std::move(base_requests))
+        .EndDict().Build();
+}
+
+json::Node CityGenerator::MakeProcessRequests(const std::string& base_file)
+{
+    json::Array stat_requests;
+    for (const std::string_view type : {"Bus"sv, "Stop"sv, "Route"sv, "Map"sv})
+    {
+        json::Array requests = MakeStatRequests(type,
+            static_cast<int>(stat_requests.size()));
+        std::move(requests.begin(), requests.end(),
+            std::back_inserter(stat_requests));
+    }
+
+    return json::Builder{}.StartDict()
+        .Key("serialization_settings"s)
+        .Value(MakeSerializationSettings(base_file))
+        .Key("stat_requests"s).Value(std::move(stat_requests))
+        .EndDict().Build();
+}
+
+json::Array CityGenerator::MakeStatRequests(std::string_view type,
+    int first_id)
+{
+    json::Array requests;
+    if (type == "Map"sv)
+    {
+        for (size_t i = 0; i < settings_.map_query_count; ++i)
+        {
+            requests.push_back(json::Builder{}.StartDict()
+                .Key("id"s).Value(first_id + static_cast<int>(i))
+                .Key("type"s).Value("Map"s)
+                .EndDict().Build());
+        }
+
+        return requests;
+    }
+
+    if (type == "Bus"sv)
+    {
+        Reseed(1);
+    }
+    else if (type == "Stop"sv)
+    {
+        Reseed(2);
+    }
+    else if (type == "Route"sv)
+    {
+        Reseed(3);
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown stat request type");
+    }
+
+    requests.reserve(settings_.query_count);
+    for (size_t i = 0; i < settings_.query_count; ++i)
+    {
+        json::Dict request{{"id"s, first_id + static_cast<int>(i)},
+            {"type"s, std::string(type)}};
+        if (type == "Bus"sv)
+        {
+            request.emplace("name"s,
+                GetBusName(NextIndex(settings_.bus_count)));
+        }
+        else if (type == "Stop"sv)
+        {
+            request.emplace("name"s,
+                GetStopName(NextIndex(settings_.stop_count)));
+        }
+        else
+        {
+            request.emplace("from"s,
+                GetStopName(NextIndex(settings_.stop_count)));
+            request.emplace("to"s,
+                GetStopName(NextIndex(settings_.stop_count)));
+        }
+        requests.push_back(std::move(request));
+    }
+
+    return requests;
+}
+
+json::Dict CityGenerator::MakeSerializationSettings(
+    const std::string& base_file)
+{
+    return json::Dict{{"file"s, base_file}};
+}
+
+std::string CityGenerator::GetStopName(size_t stop)
+{
+    return "Stop "s + std::to_string(stop);
+}
+
+std::string CityGenerator::GetBusName(size_t bus)
+{
+    return "Bus "s + std::to_string(bus);
+}
+
+void CityGenerator::Reseed(uint32_t stream)
+{
+    std::seed_seq seed{settings_.seed, stream};
+    generator_.seed(seed);
+}
+
+size_t CityGenerator::NextIndex(size_t count)
+{
+    return static_cast<size_t>(generator_()) % count;
+}
+
+double CityGenerator::NextUnit()
+{
+    return static_cast<double>(generator_()) / 4294967296.0;
+}
+
+std::vector<size_t> CityGenerator::MakeWalk()
+{
+    std::vector<size_t> stops{NextIndex(settings_.stop_count)};
+    std::vector<size_t> neighbours;
+    std::vector<size_t> unvisited;
+    while (stops.size() < settings_.route_length)
+    {
+        const size_t stop = stops.back();
+        const size_t row = stop / grid_side_;
+        const size_t column = stop % grid_side_;
+
+        neighbours.clear();
+        if (row > 0)
+        {
+            neighbours.push_back(stop - grid_side_);
+        }
+        if (stop + grid_side_ < settings_.stop_count)
+        {
+            neighbours.push_back(stop + grid_side_);
+        }
+        if (column > 0)
+        {
+            neighbours.push_back(stop - 1);
+        }
+        if (column + 1 < grid_side_ && stop + 1 < settings_.stop_count)
+        {
+            neighbours.push_back(stop + 1);
+        }
+
+        unvisited.clear();
+        std::copy_if(neighbours.begin(), neighbours.end(),
+            std::back_inserter(unvisited), [&stops](size_t neighbour)
+            {
+                return std::find(stops.begin(), stops.end(), neighbour)
+                    == stops.end();
+            });
+
+        const std::vector<size_t>& candidates =
+            unvisited.empty() ? neighbours : unvisited;
+        stops.push_back(candidates[NextIndex(candidates.size())]);
+    }
+
+    return stops;
+}
+
+json::Dict CityGenerator::MakeRenderSettings() const
+{
+    return json::Builder{}.StartDict()
+        .Key("width"s).Value(1200.0)
+        .Key("height"s).Value(1200.0)
+        .Key("padding"s).Value(50.0)
+        .Key("stop_radius"s).Value(5.0)
+        .Key("line_width"s).Value(14.0)
+        .Key("bus_label_font_size"s).Value(20)
+        .Key("bus_label_offset"s).Value(json::Array{7.0, 15.0})
+        .Key("stop_label_font_size"s).Value(20)
+        .Key("stop_label_offset"s).Value(json::Array{7.0, -3.0})
+        .Key("underlayer_color"s).Value(json::Array{255, 255, 255, 0.85})
+        .Key("underlayer_width"s).Value(3.0)
+        .Key("color_palette"s).Value(json::Array{"green"s,
+            json::Array{255, 160, 0}, "red"s})
+        .EndDict().Build().AsDict();
+}
+
+json::Dict CityGenerator::MakeRoutingSettings() const
+{
+    return json::Builder{}.StartDict()
+        .Key("bus_wait_time"s)
+        .Value(static_cast<int>(settings_.router_settings.bus_wait_time))
+        .Key("bus_velocity"s).Value(settings_.router_settings.bus_velocity)
+        .EndDict().Build().AsDict();
+}
+
+}  // namespace synthetic_city
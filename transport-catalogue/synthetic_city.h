@@ -0,0 +1,81 @@
+#pragma once
+
+#include "geo.h"
+#include "json_builder.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace synthetic_city {
+
+struct CitySettings {
+    size_t stop_count = 1000;
+    size_t bus_count = 100;
+    // Stops per bus, the first stop is repeated at the end of round trips
+    size_t route_length = 20;
+    size_t query_count = 1000;
+    size_t map_query_count = 10;
+    uint32_t seed = 1;
+    transport_router::TransportRouterSettings router_settings{6, 40.0};
+};
+
+// Generates the same city for the same settings on every platform: stops
+// lie on a jittered square grid and every bus walks between neighbouring
+// stops of the grid, so the network looks like a street map rather than a
+// random graph
+class CityGenerator {
+public:
+    explicit CityGenerator(const CitySettings& settings);
+
+    // Input of make_base with the whole city and all settings
+    json::Node MakeBaseRequests(const std::string& base_file);
+
+    // Input of process_requests with query_count requests of Bus, Stop
+    // and Route types each, followed by map_query_count Map requests
+    json::Node MakeProcessRequests(const std::string& base_file);
+
+    // query_count stat requests of the given type, or map_query_count
+    // ones for Map, numbered from first_id
+    json::Array MakeStatRequests(std::string_view type, int first_id = 0);
+
+    static json::Dict MakeSerializationSettings(const std::string& base_file);
+
+    static std::string GetStopName(size_t stop);
+
+    static std::string GetBusName(size_t bus);
+
+private:
+    CitySettings settings_;
+    size_t grid_side_ = 0;
+    std::mt19937 generator_;
+
+    // Every kind of output has its own stream of random numbers, so that
+    // it does not depend on what was generated before
+    void Reseed(uint32_t stream);
+
+    // Library distributions differ between implementations, so only raw
+    // values of the engine are used
+    size_t NextIndex(size_t count);
+
+    double NextUnit();
+
+    // Stops of a bus going from a random stop to neighbouring ones on the
+    // grid, visiting a stop again only when there is no other way
+    std::vector<size_t> MakeWalk();
+
+    json::Dict MakeRenderSettings() const;
+
+    json::Dict MakeRoutingSettings() const;
+};
+
+}  // namespace synthetic_city
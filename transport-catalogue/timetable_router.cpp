@@ -0,0 +1,146 @@
+#include "timetable_router.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace timetable_router {
+
+TimetableRouter::TimetableRouter(const TransportCatalogue& catalogue,
+    const transport_router::TransportRouterSettings& router_settings)
+    : catalogue_(catalogue)
+{
+    const transport_router::TransportRouter router(router_settings);
+
+    for (const domain::Bus& bus : catalogue_.GetAllBuses())
+    {
+        if (bus.stops.size() < 2)
+        {
+            continue;
+        }
+
+        for (const double departure : bus.departures)
+        {
+            AddTrip(bus, departure, router);
+        }
+    }
+
+    std::stable_sort(connections_.begin(), connections_.end(),
+        [](const Connection& lhs, const Connection& rhs)
+        {
+            return lhs.departure < rhs.departure;
+        });
+}
+
+std::optional<domain::Journey> TimetableRouter::BuildRoute(
+    const domain::Stop* from, const domain::Stop* to,
+    double departure_time) const
+{
+    const double INF = std::numeric_limits<double>::infinity();
+
+    std::vector<double> arrival(catalogue_.GetAllStops().size(), INF);
+    std::vector<uint32_t> in_connection(arrival.size(), NONE);
+    std::vector<uint32_t> trip_boarding(trips_.size(), NONE);
+
+    arrival[from->edge_id] = departure_time;
+
+    auto first = std::lower_bound(connections_.begin(), connections_.end(),
+        departure_time, [](const Connection& connection, double time)
+        {
+            return connection.departure < time;
+        });
+
+    for (auto it = first; it != connections_.end(); ++it)
+    {
+        const Connection& connection = *it;
+        if (arrival[to->edge_id] <= connection.departure)
+        {
+            break;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(it - connections_.begin());
+        uint32_t& boarding = trip_boarding[connection.trip];
+        if (boarding == NONE)
+        {
+            if (arrival[connection.stop_from] > connection.departure)
+            {
+                continue;
+            }
+            boarding = index;
+        }
+
+        if (connection.arrival < arrival[connection.stop_to])
+        {
+            arrival[connection.stop_to] = connection.arrival;
+            in_connection[connection.stop_to] = index;
+        }
+    }
+
+    if (in_connection[to->edge_id] == NONE)
+    {
+        return std::nullopt;
+    }
+
+    return BuildJourney(from->edge_id, to->edge_id, departure_time,
+        in_connection, trip_boarding);
+}
+
+void TimetableRouter::AddTrip(const domain::Bus& bus, double departure,
+    const transport_router::TransportRouter& router)
+{
+    const uint32_t trip = static_cast<uint32_t>(trips_.size());
+    trips_.push_back(&bus);
+
+    double time = departure;
+    uint16_t hop = 0;
+    for (size_t i = 1; i < bus.stops.size(); ++i)
+    {
+        if (bus.stops[i - 1] == bus.stops[i])
+        {
+            continue;
+        }
+
+        const double ride_time = router.ComputeEdgeWeight(
+            catalogue_.GetDistance(bus.stops[i - 1], bus.stops[i]));
+
+        connections_.push_back({bus.stops[i - 1]->edge_id,
+            bus.stops[i]->edge_id, time, time + ride_time, trip, hop++});
+
+        time += ride_time;
+    }
+}
+
+domain::Journey TimetableRouter::BuildJourney(uint32_t from, uint32_t to,
+    double departure_time, const std::vector<uint32_t>& in_connection,
+    const std::vector<uint32_t>& trip_boarding) const
+{
+    const auto& stops = catalogue_.GetAllStops();
+
+    std::vector<std::pair<const Connection*, const Connection*>> rides;
+    for (uint32_t stop = to; stop != from;)
+    {
+        const Connection& alighting = connections_[in_connection[stop]];
+        const Connection& boarding =
+            connections_[trip_boarding[alighting.trip]];
+
+        rides.emplace_back(&boarding, &alighting);
+        stop = boarding.stop_from;
+    }
+    std::reverse(rides.begin(), rides.end());
+
+    domain::Journey journey{rides.back().second->arrival - departure_time,
+        {}};
+    double time = departure_time;
+    for (const auto& [boarding, alighting] : rides)
+    {
+        journey.legs.push_back({&stops.at(boarding->stop_from),
+            boarding->departure - time, trips_[boarding->trip],
+            static_cast<uint16_t>(alighting->hop - boarding->hop + 1),
+            alighting->arrival - boarding->departure});
+
+        time = alighting->arrival;
+    }
+
+    return journey;
+}
+
+}  // namespace timetable_router
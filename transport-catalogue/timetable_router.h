@@ -0,0 +1,55 @@
+#pragma once
+
+#include "domain.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace timetable_router {
+
+using TransportCatalogue = transport_catalogue::TransportCatalogue;
+
+// Earliest arrival routing over bus departures by Connection Scan Algorithm.
+// Times are minutes from midnight. Only buses with a timetable take part:
+// a bus without departures has no trips, so a Route request with
+// departure_time never uses it and answers "not found" when no timetabled
+// bus connects the stops.
+class TimetableRouter {
+public:
+     TimetableRouter(const TransportCatalogue& catalogue,
+          const transport_router::TransportRouterSettings& router_settings);
+
+     std::optional<domain::Journey> BuildRoute(const domain::Stop* from,
+          const domain::Stop* to, double departure_time) const;
+
+private:
+     struct Connection {
+          uint32_t stop_from;
+          uint32_t stop_to;
+          double departure;
+          double arrival;
+          uint32_t trip;
+          // Number of the connection within its trip, so that hops between
+          // two connections of a trip are the ones ridden
+          uint16_t hop;
+     };
+
+     static constexpr uint32_t NONE = UINT32_MAX;
+
+     const TransportCatalogue& catalogue_;
+     std::vector<Connection> connections_;
+     std::vector<const domain::Bus*> trips_;
+
+     void AddTrip(const domain::Bus& bus, double departure,
+          const transport_router::TransportRouter& router);
+
+     domain::Journey BuildJourney(uint32_t from, uint32_t to,
+          double departure_time, const std::vector<uint32_t>& in_connection,
+          const std::vector<uint32_t>& trip_boarding) const;
+};
+
+}  // namespace timetable_router
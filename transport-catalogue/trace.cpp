@@ -0,0 +1,105 @@
+#include "trace.h"
+
+using namespace std::literals;
+
+namespace trace {
+
+namespace {
+
+// Chrome trace_event timestamps are in microseconds
+double ToMicroseconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}
+
+Tracer& Tracer::GetInstance()
+{
+    static Tracer tracer;
+
+    return tracer;
+}
+
+void Tracer::Start()
+{
+    {
+        std::lock_guard lock(mutex_);
+        events_.clear();
+        start_ = std::chrono::steady_clock::now();
+    }
+    is_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::Finish(std::ostream& output)
+{
+    is_enabled.store(false, std::memory_order_relaxed);
+
+    std::lock_guard lock(mutex_);
+    json::Array trace_events;
+    trace_events.reserve(events_.size());
+    for (const Event& event : events_)
+    {
+        json::Dict args;
+        if (event.request_id)
+        {
+            args.emplace("request_id"s, *event.request_id);
+        }
+
+        trace_events.push_back(json::Builder{}.StartDict()
+            .Key("name"s).Value(event.name)
+            .Key("cat"s).Value(std::string(event.category))
+            .Key("ph"s).Value("X"s)
+            .Key("ts"s).Value(event.start)
+            .Key("dur"s).Value(event.duration)
+            .Key("pid"s).Value(1)
+            .Key("tid"s).Value(static_cast<int>(event.thread_id))
+            .Key("args"s).Value(std::move(args))
+            .EndDict().Build());
+    }
+    events_.clear();
+
+    json::PrintCompact(json::Document{json::Builder{}.StartDict()
+        .Key("displayTimeUnit"s).Value("ms"s)
+        .Key("traceEvents"s).Value(std::move(trace_events))
+        .EndDict().Build()}, output);
+}
+
+void Tracer::AddSpan(const char* category, std::string name,
+    std::chrono::steady_clock::time_point start,
+    std::optional<int> request_id)
+{
+    const auto end = std::chrono::steady_clock::now();
+    const uint32_t thread_id = GetThreadId();
+
+    std::lock_guard lock(mutex_);
+    events_.push_back({category, std::move(name),
+        ToMicroseconds(start - start_), ToMicroseconds(end - start),
+        thread_id, request_id});
+}
+
+uint32_t Tracer::GetThreadId()
+{
+    static std::atomic<uint32_t> next_thread_id{1};
+    thread_local const uint32_t thread_id =
+        next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+    return thread_id;
+}
+
+void Span::Begin(const char* category, std::string_view name,
+    std::optional<int> request_id)
+{
+    category_ = category;
+    name_ = std::string(name);
+    request_id_ = request_id;
+    start_ = std::chrono::steady_clock::now();
+}
+
+void Span::End()
+{
+    Tracer::GetInstance().AddSpan(category_, std::move(name_), start_,
+        request_id_);
+}
+
+}  // namespace trace
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "json.h"
+#include "json_builder.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace trace {
+
+// Whether spans are being recorded. Checked by every span before anything
+// else, so that disabled tracing costs a single relaxed load
+inline std::atomic<bool> is_enabled{false};
+
+// Collects spans of all threads into a Chrome trace_event file, which
+// Perfetto and chrome://tracing open
+class Tracer {
+public:
+    static Tracer& GetInstance();
+
+    void Start();
+
+    // Stops recording and writes all spans recorded since Start
+    void Finish(std::ostream& output);
+
+    void AddSpan(const char* category, std::string name,
+        std::chrono::steady_clock::time_point start,
+        std::optional<int> request_id);
+
+private:
+    struct Event {
+        const char* category;
+        std::string name;
+        double start = 0.0;
+        double duration = 0.0;
+        uint32_t thread_id = 0;
+        std::optional<int> request_id;
+    };
+
+    std::mutex mutex_;
+    std::vector<Event> events_;
+    std::chrono::steady_clock::time_point start_;
+
+    static uint32_t GetThreadId();
+};
+
+// Records the time from its construction to destruction as a span of the
+// current thread when tracing is enabled
+class Span {
+public:
+    Span(const char* category, std::string_view name,
+        std::optional<int> request_id = std::nullopt)
+    {
+        if (is_enabled.load(std::memory_order_relaxed))
+        {
+            Begin(category, name, request_id);
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    ~Span()
+    {
+        if (category_)
+        {
+            End();
+        }
+    }
+
+private:
+    const char* category_ = nullptr;
+    std::string name_;
+    std::optional<int> request_id_;
+    std::chrono::steady_clock::time_point start_;
+
+    void Begin(const char* category, std::string_view name,
+        std::optional<int> request_id);
+
+    void End();
+};
+
+}  // namespace trace
@@ -1,5 +1,7 @@
 #include "transport_catalogue.h"
 
+#include <algorithm>
+
 namespace transport_catalogue {
 
 using StopsToDistance = std::unordered_map<std::pair<
@@ -8,36 +10,48 @@ using StopsToDistance = std::unordered_map<std::pair<
 void TransportCatalogue::AddStop(const std::string& name,
     const geo::Coordinates& coords)
 {
-    stops_.push_back({name, coords, static_cast<uint16_t>(stops_.size())});
+    const std::string_view name_strv = arena::StoreString(names_, name);
+    stops_.push_back({name_strv, coords, static_cast<uint16_t>(stops_.size())});
+
+    stop_table_.lat.push_back(coords.lat);
+    stop_table_.lng.push_back(coords.lng);
+    stop_table_.names.push_back(name_strv);
 
     domain::Stop& stop = stops_.back();
-    std::string_view name_strv = stop.name;
 
     stopname_to_stop_[name_strv] = &stop;
-
-    stopname_to_buses_[name_strv] = {};
 }
 
 void TransportCatalogue::AddBus(const std::string& name,
-    const std::vector<std::string>& stops, const bool is_round)
+    const std::vector<std::string_view>& stops, const bool is_round)
 {
-    std::vector<domain::Stop*> stops_ptr;
-    stops_ptr.reserve(stops.size());
-    for (const std::string& stop : stops)
+    domain::Stop** stops_ptr = bus_stops_.Allocate(stops.size());
+    for (size_t i = 0; i < stops.size(); ++i)
     {
-        stops_ptr.push_back(GetStop(stop));
+        stops_ptr[i] = GetStop(stops[i]);
     }
 
-    buses_.push_back({name, stops_ptr, is_round});
-
-    const auto it = std::next(buses_.end(), -1);
-    std::string_view name_strv = it->name;
-
-    busname_to_bus_[name_strv] = &(*it);
-
-    for (const domain::Stop* stop_ptr : stops_ptr)
+    const std::string_view name_strv = arena::StoreString(names_, name);
+    buses_.push_back({name_strv, {stops_ptr, stops.size()}, is_round});
+
+    busname_to_bus_[name_strv] = &buses_.back();
+
+    // A bus added again under the same name replaces the old one, as in
+    // busname_to_bus_
+    const uint32_t id = static_cast<uint32_t>(buses_.size() - 1);
+    const auto it = std::lower_bound(bus_ids_by_name_.begin(),
+        bus_ids_by_name_.end(), name_strv,
+        [this](uint32_t bus, std::string_view name)
+        {
+            return buses_[bus].name < name;
+        });
+    if (it != bus_ids_by_name_.end() && buses_[*it].name == name_strv)
+    {
+        *it = id;
+    }
+    else
     {
-        stopname_to_buses_.at(stop_ptr->name).insert(name_strv);
+        bus_ids_by_name_.insert(it, id);
     }
 }
 
@@ -47,7 +61,19 @@ void TransportCatalogue::AddDistance(const std::string& stop_from,
     stops_to_distance_[{GetStop(stop_from), GetStop(stop_to)}] = distance;
 }
         
-domain::Stop* TransportCatalogue::GetStop(const std::string& name) const
+void TransportCatalogue::AddDepartures(const std::string& bus_name,
+    const std::vector<double>& departures)
+{
+    std::vector<double>& bus_departures = GetBus(bus_name)->departures;
+
+    bus_departures.insert(bus_departures.end(), departures.begin(),
+        departures.end());
+    std::sort(bus_departures.begin(), bus_departures.end());
+    bus_departures.erase(std::unique(bus_departures.begin(),
+        bus_departures.end()), bus_departures.end());
+}
+        
+domain::Stop* TransportCatalogue::GetStop(std::string_view name) const
 {
     if (stopname_to_stop_.count(name) == 0)
     {
@@ -67,27 +93,76 @@ domain::Bus* TransportCatalogue::GetBus(const std::string& name) const
     return busname_to_bus_.at(name);
 }
 
-std::map<std::string, domain::Bus*> TransportCatalogue::GetRoutes() const
+const std::vector<uint32_t>& TransportCatalogue::GetBusIdsByName() const
 {
-    std::map<std::string, domain::Bus*> result;
+    return bus_ids_by_name_;
+}
 
-    for (const domain::Bus& bus : buses_)
+ranges::Span<const uint32_t> TransportCatalogue::GetBusesToStop(
+    const std::string& stop_name) const
+{
+    const auto it = stopname_to_stop_.find(stop_name);
+    if (it == stopname_to_stop_.end())
     {
-        result[bus.name] = busname_to_bus_.at(bus.name);
+        throw std::invalid_argument("Stop not found in catalogue");
     }
 
-    return result;
+    const size_t stop = it->second->edge_id;
+    if (stop + 1 >= stop_bus_offsets_.size())
+    {
+        throw std::logic_error("Buses of stops are not indexed");
+    }
+
+    const uint32_t first = stop_bus_offsets_[stop];
+    return {stop_bus_ids_.data() + first, stop_bus_offsets_[stop + 1] - first};
 }
 
-std::set<std::string_view> TransportCatalogue::GetBusesToStop(
-    const std::string& stop_name) const
+void TransportCatalogue::IndexStopBuses()
 {
-    if (stopname_to_buses_.count(stop_name) == 0)
+    // Buses are visited in the order of names, so the buses of every stop
+    // come out sorted; last_bus skips repeated visits of a stop by a bus
+    const uint32_t NO_BUS = static_cast<uint32_t>(-1);
+    std::vector<uint32_t> last_bus(stops_.size(), NO_BUS);
+    std::vector<uint32_t> counts(stops_.size(), 0);
+    for (const uint32_t bus : bus_ids_by_name_)
     {
-        throw std::invalid_argument("Stop not found in catalogue");
+        for (const domain::Stop* stop : buses_[bus].stops)
+        {
+            if (last_bus[stop->edge_id] != bus)
+            {
+                last_bus[stop->edge_id] = bus;
+                ++counts[stop->edge_id];
+            }
+        }
+    }
+
+    stop_bus_offsets_.assign(stops_.size() + 1, 0);
+    for (size_t i = 0; i < stops_.size(); ++i)
+    {
+        stop_bus_offsets_[i + 1] = stop_bus_offsets_[i] + counts[i];
+    }
+
+    stop_bus_ids_.assign(stop_bus_offsets_.back(), 0);
+    std::vector<uint32_t> next(stop_bus_offsets_.begin(),
+        stop_bus_offsets_.end() - 1);
+    last_bus.assign(stops_.size(), NO_BUS);
+    for (const uint32_t bus : bus_ids_by_name_)
+    {
+        for (const domain::Stop* stop : buses_[bus].stops)
+        {
+            if (last_bus[stop->edge_id] != bus)
+            {
+                last_bus[stop->edge_id] = bus;
+                stop_bus_ids_[next[stop->edge_id]++] = bus;
+            }
+        }
     }
+}
 
-    return stopname_to_buses_.at(stop_name);
+void TransportCatalogue::AddStopBuses(const std::vector<uint32_t>& bus_ids)
+{
+    stop_bus_ids_.insert(stop_bus_ids_.end(), bus_ids.begin(), bus_ids.end());
+    stop_bus_offsets_.push_back(static_cast<uint32_t>(stop_bus_ids_.size()));
 }
 
 const StopsToDistance& TransportCatalogue::GetStopsToDistance() const
@@ -105,6 +180,11 @@ const std::deque<domain::Bus>& TransportCatalogue::GetAllBuses() const
     return buses_;
 }
 
+const domain::StopTable& TransportCatalogue::GetStopTable() const
+{
+    return stop_table_;
+}
+
 int TransportCatalogue::ComputeStopsCount(const std::string& bus_name) const
 {
     return static_cast<int>(GetBus(bus_name)->stops.size());
@@ -129,7 +209,7 @@ double TransportCatalogue::ComputeRouteLength(const std::string& name) const
     for (; stop_to != bus_ptr->stops.end(); stop_from = std::next(stop_from, 1),
         stop_to = std::next(stop_to, 1))
     {
-        length += GetDistance((*stop_from)->name, (*stop_to)->name);
+        length += GetDistance(*stop_from, *stop_to);
     }
 
     return static_cast<double>(length);
@@ -138,9 +218,15 @@ double TransportCatalogue::ComputeRouteLength(const std::string& name) const
 double TransportCatalogue::ComputeCurvature(const std::string& name) const
 {
     const int length = ComputeRouteLength(name);
-    double raw_length = 0.0;
     const domain::Bus* bus_ptr = GetBus(name);
 
+    const auto geo_length_it = busname_to_geo_length_.find(bus_ptr->name);
+    if (geo_length_it != busname_to_geo_length_.end())
+    {
+        return static_cast<double>(length) / geo_length_it->second;
+    }
+
+    double raw_length = 0.0;
     auto stop_from = bus_ptr->stops.begin();
     auto stop_to = std::next(stop_from, 1);
     for (; stop_to != bus_ptr->stops.end(); stop_from = std::next(stop_from, 1),
@@ -153,29 +239,55 @@ double TransportCatalogue::ComputeCurvature(const std::string& name) const
     return static_cast<double>(length) / raw_length;
 }
 
-int TransportCatalogue::GetDistance(const std::string& stop_from,
-    const std::string& stop_to) const
+void TransportCatalogue::ComputeGeoLengths()
 {
-    domain::Stop* stop_from_ptr = GetStop(stop_from);
-    domain::Stop* stop_to_ptr = GetStop(stop_to);
+    const geo::PointsTable points = geo::MakePointsTable(stop_table_.lat,
+        stop_table_.lng);
 
-    const bool check_from_to = stops_to_distance_.count(
-        {stop_from_ptr, stop_to_ptr}) > 0;
-    const bool check_to_from = stops_to_distance_.count(
-        {stop_to_ptr, stop_from_ptr}) > 0;
+    std::vector<uint32_t> hops_from;
+    std::vector<uint32_t> hops_to;
+    for (const domain::Bus& bus : buses_)
+    {
+        for (size_t i = 1; i < bus.stops.size(); ++i)
+        {
+            hops_from.push_back(bus.stops[i - 1]->edge_id);
+            hops_to.push_back(bus.stops[i]->edge_id);
+        }
+    }
 
-    if (!check_from_to && !check_to_from)
+    std::vector<double> hops_length(hops_from.size());
+    geo::ComputeDistances(points, hops_from.data(), hops_to.data(),
+        hops_length.size(), hops_length.data());
+
+    auto hop_length = hops_length.begin();
+    for (const domain::Bus& bus : buses_)
     {
-        throw std::invalid_argument(
-            "No route between these stops in catalogue");
+        double raw_length = 0.0;
+        for (size_t i = 1; i < bus.stops.size(); ++i, ++hop_length)
+        {
+            raw_length += *hop_length;
+        }
+
+        busname_to_geo_length_[bus.name] = raw_length;
     }
+}
 
-    if (check_from_to)
+int TransportCatalogue::GetDistance(domain::Stop* stop_from,
+    domain::Stop* stop_to) const
+{
+    auto it = stops_to_distance_.find({stop_from, stop_to});
+    if (it == stops_to_distance_.end())
     {
-        return stops_to_distance_.at({stop_from_ptr, stop_to_ptr});
+        it = stops_to_distance_.find({stop_to, stop_from});
     }
 
-    return stops_to_distance_.at({stop_to_ptr, stop_from_ptr});
-} 
+    if (it == stops_to_distance_.end())
+    {
+        throw std::invalid_argument(
+            "No route between these stops in catalogue");
+    }
+
+    return it->second;
+}
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "arena.h"
 #include "domain.h"
 
 #include <deque>
@@ -11,21 +12,16 @@ namespace transport_catalogue {
 
 namespace hashers {
 
+// Hashes the whole name: names of a city often share the first letter and
+// the length, so hashing only those puts them all into a few buckets
 struct StringViewHasher {
     std::size_t operator()(const std::string_view name) const
     {
-        const int SHIFT = 27;
-
-        const int mult = name.size() + SHIFT;
-        const auto letter_it = name.begin();
-        std::size_t first = hasher_(*letter_it) * mult; 
-        std::size_t second = hasher_(*letter_it + mult) * (mult * mult); 
-
-        return (first + second) * (mult * mult * mult);
+        return hasher_(name);
     }
 
 private:
-    std::hash<char> hasher_;
+    std::hash<std::string_view> hasher_;
 };
 
 struct StopPtrsHasher {
@@ -54,35 +50,55 @@ public:
     using BusnameToBus = std::unordered_map<std::string_view,
         domain::Bus*, hashers::StringViewHasher>;
 
-    using StopnameToBuses = std::unordered_map<std::string_view,
-        std::set<std::string_view>, hashers::StringViewHasher>;
-
     using StopsToDistance = std::unordered_map<std::pair<
         domain::Stop*, domain::Stop*>, int, hashers::StopPtrsHasher>;
 
+    using BusnameToGeoLength = std::unordered_map<std::string_view,
+        double, hashers::StringViewHasher>;
+
     void AddStop(const std::string& name, const geo::Coordinates& coords);
 
+    // Stops are given as the bus goes, back to the first one for a bus that
+    // is not round. They are only looked up, not copied
     void AddBus(const std::string& name,
-        const std::vector<std::string>& stops, const bool is_round);
+        const std::vector<std::string_view>& stops, const bool is_round);
     
     void AddDistance(const std::string& stop_from, const std::string& stop_to,
         int distance);
 
-    domain::Stop* GetStop(const std::string& name) const;
+    void AddDepartures(const std::string& bus_name,
+        const std::vector<double>& departures);
+
+    domain::Stop* GetStop(std::string_view name) const;
 
     domain::Bus* GetBus(const std::string& name) const;
 
-    std::map<std::string, domain::Bus*> GetRoutes() const;
+    // Ids of all buses (indices in GetAllBuses()) sorted by name
+    const std::vector<uint32_t>& GetBusIdsByName() const;
 
-    std::set<std::string_view> GetBusesToStop(
+    // Ids of the buses through the stop (indices in GetAllBuses()), unique
+    // and sorted by bus name
+    ranges::Span<const uint32_t> GetBusesToStop(
         const std::string& stop_name) const;
+
+    // Builds the index behind GetBusesToStop, to be called once all buses
+    // are added
+    void IndexStopBuses();
+
+    // Appends buses of the next stop to the index instead of building it,
+    // as read from a base
+    void AddStopBuses(const std::vector<uint32_t>& bus_ids);
     
     const StopsToDistance& GetStopsToDistance() const;
 
+    int GetDistance(domain::Stop* stop_from, domain::Stop* stop_to) const;
+
     const std::deque<domain::Stop>& GetAllStops() const;
 
     const std::deque<domain::Bus>& GetAllBuses() const;
 
+    const domain::StopTable& GetStopTable() const;
+
     int ComputeStopsCount(const std::string& bus_name) const;
 
     int ComputeUniqueStopsCount(const std::string& bus_name) const;
@@ -91,16 +107,23 @@ public:
 
     double ComputeCurvature(const std::string& name) const;
 
+    void ComputeGeoLengths();
+
 private:
+    arena::Arena<char> names_;
+    arena::Arena<domain::Stop*> bus_stops_;
     std::deque<domain::Stop> stops_;
+    domain::StopTable stop_table_;
     std::deque<domain::Bus> buses_;
     StopnameToStop stopname_to_stop_;
     BusnameToBus busname_to_bus_;
-    StopnameToBuses stopname_to_buses_;
+    std::vector<uint32_t> bus_ids_by_name_;
+    // Buses through stop s are stop_bus_ids_[stop_bus_offsets_[s]] up to
+    // stop_bus_ids_[stop_bus_offsets_[s + 1]]
+    std::vector<uint32_t> stop_bus_offsets_ = {0};
+    std::vector<uint32_t> stop_bus_ids_;
     StopsToDistance stops_to_distance_;
-
-    int GetDistance(const std::string& stop_from,
-        const std::string& stop_to) const;
+    BusnameToGeoLength busname_to_geo_length_;
 };
 
 }
@@ -4,26 +4,196 @@ namespace transport_router {
 
 using namespace std::string_literals;
 
+namespace {
+
+// Stop a ride vertex after the first one of its chain lets off at: its
+// first edge leads back to the wait vertex of the stop
+graph::VertexId GetRideStop(const Graph& graph, graph::VertexId vertex)
+{
+    return graph.GetEdge(*graph.GetIncidentEdges(vertex).begin()).to;
+}
+
+}  // namespace
+
 TransportRouter::TransportRouter(const TransportRouterSettings& router_settings)
     : router_settings_(router_settings) {}
 
 void TransportRouter::FillGraph(const TransportCatalogue& catalogue,
-    graph::DirectedWeightedGraph<double>& graph) const
+    Graph& graph) const
+{
+    const std::deque<domain::Bus>& buses = catalogue.GetAllBuses();
+    for (const uint32_t id : catalogue.GetBusIdsByName())
+    {
+        AddBusEdges(catalogue, buses[id], graph);
+    }
+}
+
+graph::EdgesDiff TransportRouter::UpdateGraph(
+    const TransportCatalogue& catalogue, const Graph& previous,
+    const std::vector<std::optional<graph::VertexId>>& vertex_ids,
+    const std::unordered_set<std::string>& changed_buses, Graph& graph) const
 {
-    for (const auto& [name, route] : catalogue.GetRoutes())
+    using EdgeKey = std::tuple<graph::VertexId, graph::VertexId, Weight,
+        std::string_view, uint16_t>;
+
+    graph = Graph(catalogue.GetAllStops().size());
+    graph::EdgesDiff diff;
+    diff.previous_to_current.resize(previous.GetEdgeCount());
+
+    // Previous edges of changed buses, by what they connect, to be matched
+    // with the edges built anew
+    std::map<EdgeKey, std::vector<graph::EdgeId>> replaced_edges;
+    for (graph::EdgeId edge_id = previous.GetEdgeCount(); edge_id > 0;
+        --edge_id)
     {
-        const std::vector<domain::Stop*>& stops = route->stops;
+        const auto& edge = previous.GetEdge(edge_id - 1);
+        const auto from = vertex_ids.at(edge.from);
+        const auto to = vertex_ids.at(edge.to);
 
-        if (stops.size() > 1)
+        if (changed_buses.count(edge.bus_name) != 0)
         {
-            AddEdgesForwards(stops, catalogue, graph, name);
-            
-            if (!(route->is_round))
+            if (from && to)
             {
-                AddEdgesBackwards(stops, catalogue, graph, name);
+                replaced_edges[{*from, *to, edge.weight, edge.bus_name,
+                    edge.span_count}].push_back(edge_id - 1);
             }
+            continue;
+        }
+
+        if (!from || !to)
+        {
+            throw std::logic_error("Removed stop is left on bus "
+                + edge.bus_name);
+        }
+    }
+
+    for (graph::EdgeId edge_id = 0; edge_id < previous.GetEdgeCount();
+        ++edge_id)
+    {
+        const auto& edge = previous.GetEdge(edge_id);
+        if (changed_buses.count(edge.bus_name) == 0)
+        {
+            diff.previous_to_current[edge_id] = graph.AddEdge({
+                *vertex_ids[edge.from], *vertex_ids[edge.to], edge.weight,
+                edge.bus_name, edge.span_count});
         }
     }
+
+    const std::deque<domain::Bus>& buses = catalogue.GetAllBuses();
+    for (const uint32_t id : catalogue.GetBusIdsByName())
+    {
+        if (changed_buses.count(std::string(buses[id].name)) == 0)
+        {
+            continue;
+        }
+
+        const graph::EdgeId first = graph.GetEdgeCount();
+        AddBusEdges(catalogue, buses[id], graph);
+        for (graph::EdgeId edge_id = first; edge_id < graph.GetEdgeCount();
+            ++edge_id)
+        {
+            const auto& edge = graph.GetEdge(edge_id);
+            const auto it = replaced_edges.find({edge.from, edge.to,
+                edge.weight, edge.bus_name, edge.span_count});
+            if (it == replaced_edges.end() || it->second.empty())
+            {
+                diff.added.push_back(edge_id);
+                continue;
+            }
+
+            diff.previous_to_current[it->second.back()] = edge_id;
+            it->second.pop_back();
+        }
+    }
+
+    return diff;
+}
+
+void TransportRouter::FillTransferGraph(const TransportCatalogue& catalogue,
+    Graph& graph) const
+{
+    const std::deque<domain::Stop>& stops = catalogue.GetAllStops();
+    const std::deque<domain::Bus>& buses = catalogue.GetAllBuses();
+
+    size_t vertex_count = 2 * stops.size();
+    for (const domain::Bus& route : buses)
+    {
+        if (route.stops.size() > 1)
+        {
+            vertex_count += route.stops.size() * (route.is_round ? 1 : 2);
+        }
+    }
+    graph = Graph(vertex_count);
+
+    const Weight wait_weight = WeightTraits::FromMinutes(
+        router_settings_.bus_wait_time);
+    for (const domain::Stop& stop : stops)
+    {
+        graph.AddEdge({stop.edge_id, stops.size() + stop.edge_id,
+            wait_weight, ""s, 0});
+    }
+
+    graph::VertexId chain_vertex = 2 * stops.size();
+    for (const uint32_t id : catalogue.GetBusIdsByName())
+    {
+        const domain::Bus& route = buses[id];
+        const ranges::Span<domain::Stop* const> route_stops = route.stops;
+
+        if (route_stops.size() > 1)
+        {
+            const std::string name(route.name);
+            chain_vertex = AddRideChain(route_stops, false, chain_vertex,
+                catalogue, graph, name);
+
+            if (!(route.is_round))
+            {
+                chain_vertex = AddRideChain(route_stops, true, chain_vertex,
+                    catalogue, graph, name);
+            }
+        }
+    }
+}
+
+domain::Journey TransportRouter::MakeTransferJourney(
+    const TransportCatalogue& catalogue, const Graph& graph, Weight weight,
+    const std::vector<graph::EdgeId>& edges) const
+{
+    const std::deque<domain::Stop>& stops = catalogue.GetAllStops();
+    domain::Journey journey{WeightTraits::ToMinutes(weight), {}};
+
+    // A leg starts on the wait edge, rides up to the edge back to a wait
+    // vertex and takes the bus from the edges between. Hops back to the
+    // stop boarded at are not counted, as FillGraph does not count them
+    Weight ride_weight{};
+    for (const graph::EdgeId edge_id : edges)
+    {
+        const auto& edge = graph.GetEdge(edge_id);
+
+        if (edge.bus_name.empty())
+        {
+            journey.legs.push_back({&stops.at(edge.from),
+                static_cast<double>(router_settings_.bus_wait_time), nullptr,
+                0, 0.0});
+            ride_weight = Weight{};
+        }
+        else if (edge.span_count > 0)
+        {
+            ride_weight += edge.weight;
+            if (GetRideStop(graph, edge.to)
+                != journey.legs.back().stop_from->edge_id)
+            {
+                ++journey.legs.back().span_count;
+            }
+        }
+        else if (edge.to < stops.size())
+        {
+            journey.legs.back().bus = catalogue.GetBus(edge.bus_name);
+            journey.legs.back().ride_time = WeightTraits::ToMinutes(
+                ride_weight);
+        }
+    }
+
+    return journey;
 }
 
 double TransportRouter::ComputeEdgeWeight(const double distance) const
@@ -35,12 +205,29 @@ double TransportRouter::ComputeEdgeWeight(const double distance) const
         router_settings_.bus_velocity * BUS_VELOCITY_CONVERT_VALUE;
 }
 
-void TransportRouter::AddEdgesForwards(const std::vector<domain::Stop*>& stops,
+void TransportRouter::AddBusEdges(const TransportCatalogue& catalogue,
+    const domain::Bus& route, Graph& graph) const
+{
+    const ranges::Span<domain::Stop* const> stops = route.stops;
+
+    if (stops.size() > 1)
+    {
+        const std::string name(route.name);
+        AddEdgesForwards(stops, catalogue, graph, name);
+
+        if (!(route.is_round))
+        {
+            AddEdgesBackwards(stops, catalogue, graph, name);
+        }
+    }
+}
+
+void TransportRouter::AddEdgesForwards(ranges::Span<domain::Stop* const> stops,
     const TransportCatalogue& catalogue,
-    graph::DirectedWeightedGraph<double>& graph,
+    Graph& graph,
     const std::string& route_name) const
 {
-    const auto stops_to_distance = catalogue.GetStopsToDistance();
+    const auto& stops_to_distance = catalogue.GetStopsToDistance();
 
     for (int i = 0; i + 1 < static_cast<int>(stops.size()); ++i)
     {
@@ -56,8 +243,8 @@ void TransportRouter::AddEdgesForwards(const std::vector<domain::Stop*>& stops,
                     stops_to_distance.find({stops.at(j), stops.at(j - 1)}) : it_temp;
 
                 weight += ComputeEdgeWeight(it_for_dist->second);
-                graph.AddEdge({stops.at(i)->edge_id, stops.at(j)->edge_id, weight,
-                    route_name, span});
+                graph.AddEdge({stops.at(i)->edge_id, stops.at(j)->edge_id,
+                    WeightTraits::FromMinutes(weight), route_name, span});
 
                 ++span;
             }
@@ -65,12 +252,12 @@ void TransportRouter::AddEdgesForwards(const std::vector<domain::Stop*>& stops,
     }
 }
 
-void TransportRouter::AddEdgesBackwards(const std::vector<domain::Stop*>& stops,
+void TransportRouter::AddEdgesBackwards(ranges::Span<domain::Stop* const> stops,
     const TransportCatalogue& catalogue,
-    graph::DirectedWeightedGraph<double>& graph,
+    Graph& graph,
     const std::string& route_name) const
 {
-    const auto stops_to_distance = catalogue.GetStopsToDistance();
+    const auto& stops_to_distance = catalogue.GetStopsToDistance();
 
     for (int i = static_cast<int>(stops.size()) - 1; i > 0; --i)
     {
@@ -86,8 +273,8 @@ void TransportRouter::AddEdgesBackwards(const std::vector<domain::Stop*>& stops,
                     stops_to_distance.find({stops.at(j - 1), stops.at(j)}) : it_temp;
 
                 weight += ComputeEdgeWeight(it_for_dist->second);
-                graph.AddEdge({stops.at(i)->edge_id, stops.at(j - 1)->edge_id, weight,
-                    route_name, span});
+                graph.AddEdge({stops.at(i)->edge_id, stops.at(j - 1)->edge_id,
+                    WeightTraits::FromMinutes(weight), route_name, span});
 
                 ++span;
             }
@@ -95,4 +282,47 @@ void TransportRouter::AddEdgesBackwards(const std::vector<domain::Stop*>& stops,
     }
 }
 
+graph::VertexId TransportRouter::AddRideChain(
+    ranges::Span<domain::Stop* const> stops, bool is_backwards,
+    graph::VertexId first, const TransportCatalogue& catalogue, Graph& graph,
+    const std::string& route_name) const
+{
+    const size_t stop_count = catalogue.GetAllStops().size();
+    const auto stop_at = [&stops, is_backwards](size_t i)
+    {
+        return stops[is_backwards ? stops.size() - 1 - i : i];
+    };
+
+    // Ride weights are differences of the minutes since the start of the
+    // chain, rounded, so that a ride of several hops is rounded once as the
+    // FillGraph edge for it rather than hop by hop
+    double minutes = 0.0;
+    Weight chain_weight{};
+
+    // Nobody boards at the last stop of a chain or gets off at the first
+    for (size_t i = 0; i < stops.size(); ++i)
+    {
+        if (i > 0)
+        {
+            graph.AddEdge({first + i, stop_at(i)->edge_id, Weight{},
+                route_name, 0});
+        }
+
+        if (i + 1 < stops.size())
+        {
+            graph.AddEdge({stop_count + stop_at(i)->edge_id, first + i,
+                Weight{}, route_name, 0});
+
+            minutes += ComputeEdgeWeight(
+                catalogue.GetDistance(stop_at(i), stop_at(i + 1)));
+            const Weight next_weight = WeightTraits::FromMinutes(minutes);
+            graph.AddEdge({first + i, first + i + 1,
+                next_weight - chain_weight, route_name, 1});
+            chain_weight = next_weight;
+        }
+    }
+
+    return first + stops.size();
+}
+
 }  // namespace transport_router
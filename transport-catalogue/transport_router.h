@@ -2,20 +2,49 @@
 
 #include "domain.h"
 #include "graph.h"
+#include "router.h"
 #include "transport_catalogue.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
 #include <vector>
 
 namespace transport_router {
 
 using TransportCatalogue = transport_catalogue::TransportCatalogue;
 
+// Weights of the routing graph are minutes in double, or deciseconds in
+// uint32_t when built with TRANSPORT_CATALOGUE_FIXED_POINT_WEIGHTS
+#ifdef TRANSPORT_CATALOGUE_FIXED_POINT_WEIGHTS
+using Weight = uint32_t;
+#else
+using Weight = double;
+#endif
+
+using WeightTraits = graph::WeightTraits<Weight>;
+using Graph = graph::DirectedWeightedGraph<Weight>;
+using Router = graph::Router<Weight>;
+
+// Graph that Route requests without a departure time are answered on:
+// the all-pairs router over the graph of FillGraph, or a search per
+// request over the transfer graph
+enum class GraphModel {
+     CLASSIC,
+     TRANSFER,
+};
+
 struct TransportRouterSettings {
      uint16_t bus_wait_time;
      double bus_velocity;
+     GraphModel graph_model = GraphModel::CLASSIC;
 };
 
 class TransportRouter {
@@ -23,21 +52,56 @@ public:
      TransportRouter(const TransportRouterSettings& router_settings);
 
      void FillGraph(const TransportCatalogue& catalogue,
-          graph::DirectedWeightedGraph<double>& graph) const;
+          Graph& graph) const;
+
+     // Fills graph from one built by FillGraph for the previous catalogue:
+     // edges of changed_buses are built anew, edges of other buses are
+     // copied with their stops renumbered by vertex_ids. Returns where the
+     // edges of the previous graph went, an edge of a changed bus that is
+     // built again equal to itself is kept
+     graph::EdgesDiff UpdateGraph(const TransportCatalogue& catalogue,
+          const Graph& previous,
+          const std::vector<std::optional<graph::VertexId>>& vertex_ids,
+          const std::unordered_set<std::string>& changed_buses,
+          Graph& graph) const;
+
+     // Same routes with O(n) edges per bus instead of O(n^2). Stop s has a
+     // wait vertex s, where routes start and end, and a board vertex
+     // stop_count + s one bus_wait_time later. Each direction of a bus is a
+     // chain of ride vertices, one per stop, entered from board vertices
+     // and left back to wait vertices of the same stops. Routes are found
+     // on it by graph::FindRoute
+     void FillTransferGraph(const TransportCatalogue& catalogue,
+          Graph& graph) const;
+
+     // Legs of a route found by graph::FindRoute between wait vertices of
+     // the transfer graph, printed as a route on the graph of FillGraph
+     domain::Journey MakeTransferJourney(const TransportCatalogue& catalogue,
+          const Graph& graph, Weight weight,
+          const std::vector<graph::EdgeId>& edges) const;
+
+     double ComputeEdgeWeight(const double distance) const;
 
 private:
      TransportRouterSettings router_settings_;
 
-     double ComputeEdgeWeight(const double distance) const;
+     void AddBusEdges(const TransportCatalogue& catalogue,
+          const domain::Bus& route, Graph& graph) const;
 
-     void AddEdgesForwards(const std::vector<domain::Stop*>& stops,
+     void AddEdgesForwards(ranges::Span<domain::Stop* const> stops,
           const TransportCatalogue& catalogue,
-          graph::DirectedWeightedGraph<double>& graph,
+          Graph& graph,
           const std::string& route_name) const;
 
-     void AddEdgesBackwards(const std::vector<domain::Stop*>& stops,
+     void AddEdgesBackwards(ranges::Span<domain::Stop* const> stops,
           const TransportCatalogue& catalogue,
-          graph::DirectedWeightedGraph<double>& graph,
+          Graph& graph,
+          const std::string& route_name) const;
+
+     // Returns the vertex after the chain
+     graph::VertexId AddRideChain(ranges::Span<domain::Stop* const> stops,
+          bool is_backwards, graph::VertexId first,
+          const TransportCatalogue& catalogue, Graph& graph,
           const std::string& route_name) const;
 };
 